@@ -31,6 +31,7 @@ SPDX-License-Identifier: MIT
 
 */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 
@@ -41,9 +42,80 @@ static inline uint8_t decimal2bcd (uint8_t decimal)
     return (((decimal / 10) << 4) | (decimal % 10));
 }
 
-static inline uint8_t bcd2decimal(uint8_t bcd)
+/*
+ * Days since 1970-01-01 in the proleptic Gregorian calendar. Month is 1..12.
+ * See http://howardhinnant.github.io/date_algorithms.html
+ */
+static int32_t days_from_civil(int32_t year, uint8_t month, uint8_t day)
+{
+    int32_t era;
+    uint32_t yoe, doy, doe;
+
+    year -= month <= 2;
+    era = (year >= 0 ? year : year - 399) / 400;
+    yoe = (uint32_t)(year - era * 400);
+    doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+static void civil_from_days(int32_t days, int32_t *year, uint8_t *month, uint8_t *day)
+{
+    int32_t era;
+    uint32_t doe, yoe, doy, mp;
+
+    days += 719468;
+    era = (days >= 0 ? days : days - 146096) / 146097;
+    doe = (uint32_t)(days - era * 146097);
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = (int32_t)yoe + era * 400 + (*month <= 2);
+}
+
+/* CRC-8 with polynomial 0x07. */
+static uint8_t crc8(const uint8_t *data, uint8_t size)
+{
+    uint8_t crc = 0x00;
+
+    for (uint8_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/* 0..6, 1970-01-01 was a Thursday. */
+static uint8_t weekday_from_days(int32_t days)
 {
-   return (((bcd >> 4) * 10) + (bcd & 0x0f));
+    return days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6;
+}
+
+/* First minute of the day after the given one matching the alarm, or -1. */
+static int16_t alarm_minute(const struct tm *alarm, int16_t after)
+{
+    int16_t minute;
+
+    if (PCF8563_ALARM_NONE != alarm->tm_min && PCF8563_ALARM_NONE != alarm->tm_hour) {
+        minute = alarm->tm_hour * 60 + alarm->tm_min;
+    } else if (PCF8563_ALARM_NONE != alarm->tm_min) {
+        minute = after < alarm->tm_min ? alarm->tm_min : ((after - alarm->tm_min) / 60 + 1) * 60 + alarm->tm_min;
+    } else if (PCF8563_ALARM_NONE != alarm->tm_hour) {
+        minute = after < alarm->tm_hour * 60 ? alarm->tm_hour * 60 : after + 1;
+        if (minute / 60 != alarm->tm_hour) {
+            return -1;
+        }
+    } else {
+        minute = after + 1;
+    }
+
+    return minute > after && minute < 1440 ? minute : -1;
 }
 
 pcf8563_err_t pcf8563_init(const pcf8563_t *pcf)
@@ -58,67 +130,98 @@ pcf8563_err_t pcf8563_init(const pcf8563_t *pcf)
     return pcf->write(pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS2, &clear, 1);
 }
 
-pcf8563_err_t pcf8563_read(const pcf8563_t *pcf, struct tm *time)
+pcf8563_err_t pcf8563_init_warm(const pcf8563_t *pcf)
 {
-    uint8_t bcd;
-    uint8_t data[PCF8563_TIME_SIZE] = {0};
-    uint16_t century;
+    uint8_t data[3] = {0};
+    uint8_t wanted[2];
     int32_t status;
 
-    status = pcf->read(
-        pcf->handle, PCF8563_ADDRESS, PCF8563_SECONDS, data, PCF8563_TIME_SIZE
-    );
+    /* Both control registers and seconds for the VL bit in one burst. */
+    status = pcf->read(pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS1, data, 3);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    /* Clock running, normal mode. Keep armed alarm and timer interrupts. */
+    wanted[0] = 0x00;
+    wanted[1] = data[1] & (PCF8563_TI_TP | PCF8563_AF | PCF8563_TF | PCF8563_AIE | PCF8563_TIE);
+
+    if (wanted[1] != data[1]) {
+        status = pcf->write(pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS1, wanted, 2);
+    } else if (wanted[0] != data[0]) {
+        status = pcf->write(pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS1, wanted, 1);
+    }
 
     if (PCF8563_OK != status) {
         return status;
     }
 
+    /* low voltage warning */
+    if (data[2] & 0b10000000) {
+        return PCF8563_ERR_LOW_VOLTAGE;
+    }
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_read_raw(const pcf8563_t *pcf, uint8_t *buffer)
+{
+    return pcf->read(
+        pcf->handle, PCF8563_ADDRESS, PCF8563_SECONDS, buffer, PCF8563_TIME_SIZE
+    );
+}
+
+pcf8563_err_t pcf8563_raw_to_tm(const uint8_t *buffer, struct tm *time)
+{
     /* 0..59 */
-    bcd = data[0] & 0b01111111;
-    time->tm_sec = bcd2decimal(bcd);
+    time->tm_sec = pcf8563_raw_seconds(buffer);
 
     /* 0..59 */
-    bcd = data[1] & 0b01111111;
-    time->tm_min = bcd2decimal(bcd);
+    time->tm_min = pcf8563_raw_minutes(buffer);
 
     /* 0..23 */
-    bcd = data[2] & 0b00111111;
-    time->tm_hour = bcd2decimal(bcd);
+    time->tm_hour = pcf8563_raw_hours(buffer);
 
     /* 1..31 */
-    bcd = data[3] & 0b00111111;
-    time->tm_mday = bcd2decimal(bcd);
+    time->tm_mday = pcf8563_raw_day(buffer);
 
     /* 0..6 */
-    bcd = data[4] & 0b00000111;
-    time->tm_wday = bcd2decimal(bcd);
+    time->tm_wday = pcf8563_raw_weekday(buffer);
 
     /* 0..11 */
-    bcd = data[5] & 0b00011111;
-    time->tm_mon = bcd2decimal(bcd) - 1;
-
-    /* If century bit set assume it is 2000. */
-    century = (data[5] & PCF8563_CENTURY_BIT) ? 100 : 0;
+    time->tm_mon = pcf8563_raw_month(buffer) - 1;
 
     /* Number of years since 1900. */
-    bcd = data[6] & 0b11111111;
-    time->tm_year = bcd2decimal(bcd) + century;
+    time->tm_year = pcf8563_raw_year(buffer) - 1900;
 
     /* Calculate tm_yday. */
     mktime(time);
 
     /* low voltage warning */
-    if (data[0] & 0b10000000) {
+    if (pcf8563_raw_low_voltage(buffer)) {
         return PCF8563_ERR_LOW_VOLTAGE;
     }
 
     return PCF8563_OK;
 }
 
-pcf8563_err_t pcf8563_write(const pcf8563_t *pcf, const struct tm *time)
+pcf8563_err_t pcf8563_read(const pcf8563_t *pcf, struct tm *time)
 {
-    uint8_t bcd;
     uint8_t data[PCF8563_TIME_SIZE] = {0};
+    int32_t status;
+
+    status = pcf8563_read_raw(pcf, data);
+
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    return pcf8563_raw_to_tm(data, time);
+}
+
+void pcf8563_tm_to_raw(const struct tm *time, uint8_t *data)
+{
+    uint8_t bcd;
 
     /* 0..59 */
     bcd = decimal2bcd(time->tm_sec);
@@ -152,101 +255,961 @@ pcf8563_err_t pcf8563_write(const pcf8563_t *pcf, const struct tm *time)
     /* 0..99 */
     bcd = decimal2bcd(time->tm_year % 100);
     data[6] = bcd & 0b11111111;
+}
+
+/*
+ * Write only the smallest contiguous span of registers which differs from
+ * the image. Bits outside the mask are ignored when comparing. Image is
+ * updated to match the new contents.
+ */
+static pcf8563_err_t write_changed(
+    const pcf8563_t *pcf, uint8_t reg, const uint8_t *data, uint8_t *image,
+    const uint8_t *mask, uint8_t size
+)
+{
+    int8_t first = -1;
+    int8_t last = -1;
+    int32_t status;
+
+    for (uint8_t i = 0; i < size; i++) {
+        if ((data[i] ^ image[i]) & mask[i]) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+
+    /* Nothing changed, no need to touch the bus. */
+    if (first < 0) {
+        return PCF8563_OK;
+    }
+
+    status = pcf->write(
+        pcf->handle, PCF8563_ADDRESS, reg + first, data + first, last - first + 1
+    );
+
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    for (uint8_t i = first; i <= last; i++) {
+        image[i] = data[i];
+    }
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_write(const pcf8563_t *pcf, const struct tm *time)
+{
+    uint8_t data[PCF8563_TIME_SIZE] = {0};
+
+    pcf8563_tm_to_raw(time, data);
 
     return pcf->write(pcf->handle, PCF8563_ADDRESS, PCF8563_SECONDS, data, PCF8563_TIME_SIZE);
 }
 
-pcf8563_err_t pcf8563_ioctl(const pcf8563_t *pcf, int16_t command, void *buffer)
+pcf8563_err_t pcf8563_write_raw(const pcf8563_t *pcf, const uint8_t *buffer)
 {
-    uint8_t reg = command >> 8;
-    uint8_t data[PCF8563_ALARM_SIZE] = {0};
-    uint8_t status;
-    struct tm *time;
+    return pcf->write(pcf->handle, PCF8563_ADDRESS, PCF8563_SECONDS, buffer, PCF8563_TIME_SIZE);
+}
 
-    switch (command) {
-    case PCF8563_ALARM_SET:
-        time = (struct tm *)buffer;
+pcf8563_err_t pcf8563_write_diff(const pcf8563_t *pcf, const struct tm *time, uint8_t *image)
+{
+    static const uint8_t mask[PCF8563_TIME_SIZE] = {
+        0b01111111, 0b01111111, 0b00111111, 0b00111111,
+        0b00000111, 0b10011111, 0b11111111
+    };
+    uint8_t data[PCF8563_TIME_SIZE] = {0};
+    uint8_t current[PCF8563_TIME_SIZE] = {0};
+    int32_t status;
 
-        /* 0..59 */
-        if (PCF8563_ALARM_NONE == time->tm_min) {
-            data[0] = PCF8563_ALARM_DISABLE;
-        } else {
-            data[0] = decimal2bcd(time->tm_min);
+    pcf8563_tm_to_raw(time, data);
+
+    /* Without a cached image do a quick burst read of the registers. */
+    if (NULL == image) {
+        status = pcf->read(
+            pcf->handle, PCF8563_ADDRESS, PCF8563_SECONDS, current, PCF8563_TIME_SIZE
+        );
+
+        if (PCF8563_OK != status) {
+            return status;
         }
+        image = current;
+    }
 
-        /* 0..23 */
-        if (PCF8563_ALARM_NONE == time->tm_hour) {
-            data[1] = PCF8563_ALARM_DISABLE;
+    return write_changed(pcf, PCF8563_SECONDS, data, image, mask, PCF8563_TIME_SIZE);
+}
+
+static void datetime2registers(pcf8563_datetime_t datetime, uint8_t *data)
+{
+    uint16_t year = pcf8563_datetime_year(datetime);
+
+    data[0] = decimal2bcd(pcf8563_datetime_second(datetime)) & 0b01111111;
+    data[1] = decimal2bcd(pcf8563_datetime_minute(datetime)) & 0b01111111;
+    data[2] = decimal2bcd(pcf8563_datetime_hour(datetime)) & 0b00111111;
+    data[3] = decimal2bcd(pcf8563_datetime_day(datetime)) & 0b00111111;
+    data[4] = pcf8563_datetime_weekday(datetime) & 0b00000111;
+    data[5] = decimal2bcd(pcf8563_datetime_month(datetime)) & 0b00011111;
+
+    /* If 2000 set the century bit. */
+    if (year >= 2000) {
+        data[5] |= PCF8563_CENTURY_BIT;
+    }
+
+    /* 0..99 */
+    data[6] = decimal2bcd(year % 100);
+}
+
+pcf8563_err_t pcf8563_read_datetime(const pcf8563_t *pcf, pcf8563_datetime_t *datetime)
+{
+    uint8_t data[PCF8563_TIME_SIZE] = {0};
+    int32_t status;
+
+    status = pcf8563_read_raw(pcf, data);
+
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    *datetime = pcf8563_raw_to_datetime(data);
+
+    /* low voltage warning */
+    if (pcf8563_raw_low_voltage(data)) {
+        return PCF8563_ERR_LOW_VOLTAGE;
+    }
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_write_datetime(const pcf8563_t *pcf, pcf8563_datetime_t datetime)
+{
+    uint8_t data[PCF8563_TIME_SIZE] = {0};
+
+    datetime2registers(datetime, data);
+
+    return pcf->write(pcf->handle, PCF8563_ADDRESS, PCF8563_SECONDS, data, PCF8563_TIME_SIZE);
+}
+
+pcf8563_datetime_t pcf8563_datetime_from_tm(const struct tm *time)
+{
+    return PCF8563_DATETIME(
+        time->tm_year + 1900, time->tm_mon + 1, time->tm_mday,
+        time->tm_hour, time->tm_min, time->tm_sec, time->tm_wday
+    );
+}
+
+void pcf8563_datetime_to_tm(pcf8563_datetime_t datetime, struct tm *time)
+{
+    uint16_t year = pcf8563_datetime_year(datetime);
+    uint8_t month = pcf8563_datetime_month(datetime);
+    uint8_t day = pcf8563_datetime_day(datetime);
+
+    time->tm_sec = pcf8563_datetime_second(datetime);
+    time->tm_min = pcf8563_datetime_minute(datetime);
+    time->tm_hour = pcf8563_datetime_hour(datetime);
+    time->tm_mday = day;
+    time->tm_mon = month - 1;
+    time->tm_year = year - 1900;
+    time->tm_wday = pcf8563_datetime_weekday(datetime);
+    time->tm_yday = days_from_civil(year, month, day) - days_from_civil(year, 1, 1);
+    time->tm_isdst = 0;
+}
+
+int64_t pcf8563_datetime_to_epoch(pcf8563_datetime_t datetime)
+{
+    int64_t days;
+
+    days = days_from_civil(
+        pcf8563_datetime_year(datetime),
+        pcf8563_datetime_month(datetime),
+        pcf8563_datetime_day(datetime)
+    );
+
+    return days * 86400
+        + pcf8563_datetime_hour(datetime) * 3600
+        + pcf8563_datetime_minute(datetime) * 60
+        + pcf8563_datetime_second(datetime);
+}
+
+pcf8563_datetime_t pcf8563_datetime_from_epoch(int64_t epoch)
+{
+    int32_t days, year, seconds;
+    uint8_t month, day;
+
+    /* Keeps the day count in 32 bits and the year in its 16 bit field. */
+    if (epoch < PCF8563_DATETIME_EPOCH_MIN) {
+        epoch = PCF8563_DATETIME_EPOCH_MIN;
+    } else if (epoch > PCF8563_DATETIME_EPOCH_MAX) {
+        epoch = PCF8563_DATETIME_EPOCH_MAX;
+    }
+
+    days = (int32_t)(epoch / 86400);
+    seconds = (int32_t)(epoch % 86400);
+    if (seconds < 0) {
+        seconds += 86400;
+        days -= 1;
+    }
+
+    civil_from_days(days, &year, &month, &day);
+
+    return PCF8563_DATETIME(
+        year, month, day,
+        seconds / 3600, seconds / 60 % 60, seconds % 60,
+        weekday_from_days(days)
+    );
+}
+
+int64_t pcf8563_datetime_diff(pcf8563_datetime_t a, pcf8563_datetime_t b)
+{
+    return pcf8563_datetime_to_epoch(a) - pcf8563_datetime_to_epoch(b);
+}
+
+void pcf8563_alarm_to_raw(const struct tm *time, uint8_t *data)
+{
+    /* 0..59 */
+    if (PCF8563_ALARM_NONE == time->tm_min) {
+        data[0] = PCF8563_ALARM_DISABLE;
+    } else {
+        data[0] = decimal2bcd(time->tm_min);
+    }
+
+    /* 0..23 */
+    if (PCF8563_ALARM_NONE == time->tm_hour) {
+        data[1] = PCF8563_ALARM_DISABLE;
+    } else {
+        data[1] = decimal2bcd(time->tm_hour);
+        data[1] &= 0b00111111;
+    }
+
+    /* 1..31 */
+    if (PCF8563_ALARM_NONE == time->tm_mday) {
+        data[2] = PCF8563_ALARM_DISABLE;
+    } else {
+        data[2] = decimal2bcd(time->tm_mday);
+        data[2] &= 0b00111111;
+    }
+
+    /* 0..6 */
+    if (PCF8563_ALARM_NONE == time->tm_wday) {
+        data[3] = PCF8563_ALARM_DISABLE;
+    } else {
+        data[3] = decimal2bcd(time->tm_wday);
+        data[3] &= 0b00000111;
+    }
+}
+
+void pcf8563_raw_to_alarm(const uint8_t *data, struct tm *time)
+{
+    /* 0..59 */
+    if (PCF8563_ALARM_DISABLE & data[0]) {
+        time->tm_min = PCF8563_ALARM_NONE;
+    } else {
+        time->tm_min = pcf8563_bcd2decimal(data[0] & 0b01111111);
+    }
+
+    /* 0..23 */
+    if (PCF8563_ALARM_DISABLE & data[1]) {
+        time->tm_hour = PCF8563_ALARM_NONE;
+    } else {
+        time->tm_hour = pcf8563_bcd2decimal(data[1] & 0b00111111);
+    }
+
+    /* 1..31 */
+    if (PCF8563_ALARM_DISABLE & data[2]) {
+        time->tm_mday = PCF8563_ALARM_NONE;
+    } else {
+        time->tm_mday = pcf8563_bcd2decimal(data[2] & 0b00111111);
+    }
+
+    /* 0..6 */
+    if (PCF8563_ALARM_DISABLE & data[3]) {
+        time->tm_wday = PCF8563_ALARM_NONE;
+    } else {
+        time->tm_wday = pcf8563_bcd2decimal(data[3] & 0b00000111);
+    }
+}
+
+/*
+ * Next time after now when the alarm sets AF. AF is set at every minute
+ * change where all enabled fields match. Weekday follows the device
+ * weekday register, now->tm_wday, which need not agree with the date.
+ */
+pcf8563_err_t pcf8563_alarm_next(const struct tm *now, const struct tm *alarm, struct tm *next)
+{
+    int32_t today, days, year;
+    uint8_t month, day;
+    int16_t minute;
+
+    if (PCF8563_ALARM_NONE == alarm->tm_min && PCF8563_ALARM_NONE == alarm->tm_hour &&
+        PCF8563_ALARM_NONE == alarm->tm_mday && PCF8563_ALARM_NONE == alarm->tm_wday) {
+        return PCF8563_ERR_INVALID;
+    }
+    if ((PCF8563_ALARM_NONE != alarm->tm_min && (alarm->tm_min < 0 || alarm->tm_min > 59)) ||
+        (PCF8563_ALARM_NONE != alarm->tm_hour && (alarm->tm_hour < 0 || alarm->tm_hour > 23)) ||
+        (PCF8563_ALARM_NONE != alarm->tm_mday && (alarm->tm_mday < 1 || alarm->tm_mday > 31)) ||
+        (PCF8563_ALARM_NONE != alarm->tm_wday && (alarm->tm_wday < 0 || alarm->tm_wday > 6))) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    today = days_from_civil(now->tm_year + 1900, now->tm_mon + 1, now->tm_mday);
+    year = now->tm_year + 1900;
+    month = now->tm_mon + 1;
+    day = now->tm_mday;
+    days = today;
+    minute = alarm_minute(alarm, now->tm_hour * 60 + now->tm_min);
+
+    if (minute < 0 ||
+        (PCF8563_ALARM_NONE != alarm->tm_mday && alarm->tm_mday != day) ||
+        (PCF8563_ALARM_NONE != alarm->tm_wday && alarm->tm_wday != now->tm_wday)) {
+        minute = alarm_minute(alarm, -1);
+
+        if (PCF8563_ALARM_NONE != alarm->tm_mday) {
+            /* Walk the months, bounded by one 400 year Gregorian cycle. */
+            for (uint16_t i = 0; ; i++) {
+                int32_t following = days_from_civil(year + (12 == month), month % 12 + 1, 1);
+
+                days = days_from_civil(year, month, alarm->tm_mday);
+                if (days > today && days < following && (PCF8563_ALARM_NONE == alarm->tm_wday ||
+                    alarm->tm_wday == (now->tm_wday + days - today) % 7)) {
+                    break;
+                }
+                if (4800 == i) {
+                    return PCF8563_ERR_INVALID;
+                }
+                year += 12 == month;
+                month = month % 12 + 1;
+            }
+        } else if (PCF8563_ALARM_NONE != alarm->tm_wday) {
+            days = today + (alarm->tm_wday - now->tm_wday + 6) % 7 + 1;
         } else {
-            data[1] = decimal2bcd(time->tm_hour);
-            data[1] &= 0b00111111;
+            days = today + 1;
+        }
+    }
+
+    civil_from_days(days, &year, &month, &day);
+
+    next->tm_sec = 0;
+    next->tm_min = minute % 60;
+    next->tm_hour = minute / 60;
+    next->tm_mday = day;
+    next->tm_mon = month - 1;
+    next->tm_year = year - 1900;
+    next->tm_wday = (now->tm_wday + days - today) % 7;
+    next->tm_yday = days - days_from_civil(year, 1, 1);
+    next->tm_isdst = 0;
+
+    return PCF8563_OK;
+}
+
+/*
+ * Work out when AF or TF could next be set from an image of registers
+ * 0x00..0x0f. Phase of the timer source clock and the fraction of the
+ * current second are unknown, hence the window between earliest and
+ * latest.
+ */
+void pcf8563_poll_plan_raw(const uint8_t *raw, pcf8563_poll_t *plan)
+{
+    /* Timer source clock is hz / divider. */
+    static const uint16_t hz[4] = {4096, 64, 1, 1};
+    static const uint8_t divider[4] = {1, 1, 1, 60};
+    uint8_t control = raw[PCF8563_TIMER_CONTROL];
+    uint8_t count = raw[PCF8563_TIMER];
+    pcf8563_datetime_t datetime;
+    struct tm now, alarm, next;
+    uint64_t earliest, latest;
+    int64_t seconds;
+
+    plan->flags = raw[PCF8563_CONTROL_STATUS2] & (PCF8563_AF | PCF8563_TF);
+    plan->earliest_us = PCF8563_POLL_NEVER;
+    plan->latest_us = PCF8563_POLL_NEVER;
+
+    if (plan->flags) {
+        plan->earliest_us = 0;
+        plan->latest_us = 0;
+        return;
+    }
+
+    /* Divider chain is stopped, neither clock nor timer advance. */
+    if (raw[PCF8563_CONTROL_STATUS1] & PCF8563_STOP) {
+        return;
+    }
+
+    /* Flag is set when the count reaches zero. */
+    if ((control & PCF8563_TIMER_ENABLE) && count) {
+        control &= 0b00000011;
+        plan->earliest_us = (uint64_t)(count - 1) * 1000000 * divider[control] / hz[control];
+        plan->latest_us = ((uint64_t)count * 1000000 * divider[control] + hz[control] - 1) / hz[control];
+    }
+
+    pcf8563_raw_to_alarm(&raw[PCF8563_MINUTE_ALARM], &alarm);
+    datetime = pcf8563_raw_to_datetime(&raw[PCF8563_SECONDS]);
+    pcf8563_datetime_to_tm(datetime, &now);
+
+    if (PCF8563_OK == pcf8563_alarm_next(&now, &alarm, &next)) {
+        seconds = pcf8563_datetime_to_epoch(pcf8563_datetime_from_tm(&next))
+            - pcf8563_datetime_to_epoch(datetime);
+        earliest = (uint64_t)(seconds - 1) * 1000000;
+        latest = (uint64_t)seconds * 1000000;
+
+        if (earliest < plan->earliest_us) {
+            plan->earliest_us = earliest;
         }
+        if (latest < plan->latest_us) {
+            plan->latest_us = latest;
+        }
+    }
+}
+
+pcf8563_err_t pcf8563_poll_plan(const pcf8563_t *pcf, pcf8563_poll_t *plan)
+{
+    uint8_t raw[PCF8563_POLL_SIZE] = {0};
+    int32_t status;
+
+    status = pcf->read(
+        pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS1, raw, PCF8563_POLL_SIZE
+    );
+
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    pcf8563_poll_plan_raw(raw, plan);
+    return PCF8563_OK;
+}
+
+/* Parse one cron field such as "*", "1-5", "0,30" or a stepped range into bits. */
+static const char *cron_field(const char *cursor, uint8_t min, uint8_t max, uint64_t *bits)
+{
+    uint16_t first, last, step;
+
+    *bits = 0;
 
-        /* 1..31 */
-        if (PCF8563_ALARM_NONE == time->tm_mday) {
-            data[2] = PCF8563_ALARM_DISABLE;
+    while (' ' == *cursor) {
+        cursor++;
+    }
+
+    do {
+        if (',' == *cursor) {
+            cursor++;
+        }
+
+        if ('*' == *cursor) {
+            first = min;
+            last = max;
+            cursor++;
         } else {
-            data[2] = decimal2bcd(time->tm_mday);
-            data[2] &= 0b00111111;
+            if (*cursor < '0' || *cursor > '9') {
+                return NULL;
+            }
+            for (first = 0; *cursor >= '0' && *cursor <= '9' && first <= max; cursor++) {
+                first = first * 10 + *cursor - '0';
+            }
+            last = first;
+            if ('-' == *cursor) {
+                cursor++;
+                if (*cursor < '0' || *cursor > '9') {
+                    return NULL;
+                }
+                for (last = 0; *cursor >= '0' && *cursor <= '9' && last <= max; cursor++) {
+                    last = last * 10 + *cursor - '0';
+                }
+            }
+        }
+
+        step = 1;
+        if ('/' == *cursor) {
+            cursor++;
+            if (*cursor < '0' || *cursor > '9') {
+                return NULL;
+            }
+            for (step = 0; *cursor >= '0' && *cursor <= '9' && step <= max; cursor++) {
+                step = step * 10 + *cursor - '0';
+            }
+            /* "5/15" means from 5 to the end of the range. */
+            if (first == last) {
+                last = max;
+            }
+        }
+
+        if (first < min || last > max || first > last || 0 == step) {
+            return NULL;
+        }
+        for (uint16_t value = first; value <= last; value += step) {
+            *bits |= (uint64_t)1 << value;
         }
+    } while (',' == *cursor);
 
-        /* 0..6 */
-        if (PCF8563_ALARM_NONE == time->tm_mday) {
-            data[3] = PCF8563_ALARM_DISABLE;
+    if (' ' != *cursor && '\0' != *cursor) {
+        return NULL;
+    }
+    return cursor;
+}
+
+/* Lowest set bit at or above from, or limit if there is none. */
+static uint8_t cron_bit(uint64_t bits, uint8_t from, uint8_t limit)
+{
+    while (from < limit && !(bits >> from & 1)) {
+        from++;
+    }
+    return from;
+}
+
+/*
+ * Compile "minute hour day month weekday" with the usual cron syntax. When
+ * both day of month and weekday are restricted either of them matches.
+ * Weekday 7 is an alias for Sunday.
+ */
+pcf8563_err_t pcf8563_cron_compile(const char *expression, pcf8563_cron_t *cron)
+{
+    const char *cursor = expression;
+    uint64_t bits;
+
+    cron->flags = 0;
+
+    cursor = cron_field(cursor, 0, 59, &bits);
+    if (NULL == cursor) {
+        return PCF8563_ERR_INVALID;
+    }
+    cron->minutes = bits;
+
+    cursor = cron_field(cursor, 0, 23, &bits);
+    if (NULL == cursor) {
+        return PCF8563_ERR_INVALID;
+    }
+    cron->hours = bits;
+
+    while (' ' == *cursor) {
+        cursor++;
+    }
+    if ('*' == *cursor) {
+        cron->flags |= PCF8563_CRON_ANY_DAY;
+    }
+    cursor = cron_field(cursor, 1, 31, &bits);
+    if (NULL == cursor) {
+        return PCF8563_ERR_INVALID;
+    }
+    cron->days = bits;
+
+    cursor = cron_field(cursor, 1, 12, &bits);
+    if (NULL == cursor) {
+        return PCF8563_ERR_INVALID;
+    }
+    cron->months = bits;
+
+    while (' ' == *cursor) {
+        cursor++;
+    }
+    if ('*' == *cursor) {
+        cron->flags |= PCF8563_CRON_ANY_WEEKDAY;
+    }
+    cursor = cron_field(cursor, 0, 7, &bits);
+    if (NULL == cursor) {
+        return PCF8563_ERR_INVALID;
+    }
+    cron->weekdays = (bits | bits >> 7) & 0b01111111;
+
+    while (' ' == *cursor) {
+        cursor++;
+    }
+    if ('\0' != *cursor) {
+        return PCF8563_ERR_INVALID;
+    }
+    return PCF8563_OK;
+}
+
+/* Next occurrence strictly after now. Weekdays follow the calendar. */
+pcf8563_err_t pcf8563_cron_next(const pcf8563_cron_t *cron, const struct tm *now, struct tm *next)
+{
+    int32_t year = now->tm_year + 1900;
+    uint8_t month = now->tm_mon + 1;
+    uint8_t day = now->tm_mday;
+    uint8_t hour = now->tm_hour;
+    uint8_t minute = now->tm_min + 1;
+    uint32_t weekdays, candidates;
+    uint8_t first, length, found;
+    int32_t days;
+
+    /*
+     * Each pass handles one month, so the worst case is a leap day which is
+     * eight years away across 2100. The loops inside jump between set bits.
+     */
+    for (uint8_t i = 0; i < 8 * 13; i++) {
+        found = cron_bit(cron->months, month, 13);
+        if (found > 12) {
+            year++;
+            month = 1;
+            day = 1;
+            hour = 0;
+            minute = 0;
+            continue;
+        }
+        if (found != month) {
+            month = found;
+            day = 1;
+            hour = 0;
+            minute = 0;
+        }
+
+        days = days_from_civil(year, month, 1);
+        length = days_from_civil(year + (12 == month), month % 12 + 1, 1) - days;
+        first = weekday_from_days(days);
+
+        /* Weekdays as days of this month, bit n is day n. */
+        weekdays = ((cron->weekdays >> first) | (cron->weekdays << (7 - first))) & 0b01111111;
+        weekdays = (weekdays | weekdays << 7 | weekdays << 14 | weekdays << 21 | weekdays << 28) << 1;
+
+        if (cron->flags & (PCF8563_CRON_ANY_DAY | PCF8563_CRON_ANY_WEEKDAY)) {
+            candidates = cron->days & weekdays;
         } else {
-            data[3] = decimal2bcd(time->tm_wday);
-            data[3] &= 0b00000111;
+            candidates = cron->days | weekdays;
         }
+        candidates &= (0xffffffff >> (31 - length)) & ~1U;
 
-        return pcf->write(
-            pcf->handle, PCF8563_ADDRESS, reg, data, PCF8563_ALARM_SIZE
-        );
+        found = cron_bit(candidates, day, 32);
+        if (found != day) {
+            day = found;
+            hour = 0;
+            minute = 0;
+        }
 
-        break;
+        for (; day <= length; day = cron_bit(candidates, day + 1, 32), hour = 0, minute = 0) {
+            for (; ; hour++, minute = 0) {
+                found = cron_bit(cron->hours, hour, 24);
+                if (found >= 24) {
+                    break;
+                }
+                if (found != hour) {
+                    hour = found;
+                    minute = 0;
+                }
+                minute = cron_bit(cron->minutes, minute, 60);
+                if (minute < 60) {
+                    next->tm_sec = 0;
+                    next->tm_min = minute;
+                    next->tm_hour = hour;
+                    next->tm_mday = day;
+                    next->tm_mon = month - 1;
+                    next->tm_year = year - 1900;
+                    next->tm_wday = (first + day - 1) % 7;
+                    next->tm_yday = days + day - 1 - days_from_civil(year, 1, 1);
+                    next->tm_isdst = 0;
+                    return PCF8563_OK;
+                }
+            }
+        }
 
-    case PCF8563_ALARM_READ:
-        time = (struct tm *)buffer;
+        year += 12 == month;
+        month = month % 12 + 1;
+        day = 1;
+        hour = 0;
+        minute = 0;
+    }
 
-        /* 0..59 */
+    /* For example the 30th of February. */
+    return PCF8563_ERR_INVALID;
+}
+
+/*
+ * Program the next occurrence into the alarm, writing only the alarm
+ * registers which differ from image. Without image the registers are
+ * read first. The alarm cannot match months so an occurrence in a later
+ * month may need an earlier wakeup. Next is set to when the alarm will
+ * really fire, compare with pcf8563_cron_next() and arm again if needed.
+ */
+pcf8563_err_t pcf8563_cron_arm(
+    const pcf8563_t *pcf, const pcf8563_cron_t *cron, const struct tm *now,
+    struct tm *next, uint8_t *image
+)
+{
+    static const uint8_t mask[PCF8563_ALARM_SIZE] = {0xff, 0xff, 0xff, 0xff};
+    uint8_t data[PCF8563_ALARM_SIZE] = {0};
+    uint8_t current[PCF8563_ALARM_SIZE] = {0};
+    struct tm alarm = {0};
+    int32_t status;
+
+    status = pcf8563_cron_next(cron, now, next);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    alarm.tm_min = next->tm_min;
+    alarm.tm_hour = next->tm_hour;
+    alarm.tm_mday = next->tm_mday;
+    alarm.tm_wday = PCF8563_ALARM_NONE;
+    pcf8563_alarm_to_raw(&alarm, data);
+
+    if (NULL == image) {
         status = pcf->read(
-            pcf->handle, PCF8563_ADDRESS, reg, data, PCF8563_ALARM_SIZE
+            pcf->handle, PCF8563_ADDRESS, PCF8563_MINUTE_ALARM, current, PCF8563_ALARM_SIZE
         );
 
         if (PCF8563_OK != status) {
             return status;
         }
+        image = current;
+    }
 
-        if (PCF8563_ALARM_DISABLE & data[0]) {
-            time->tm_min = PCF8563_ALARM_NONE;
-        } else {
-            data[0] &= 0b01111111;
-            time->tm_min = bcd2decimal(data[0]);
-        }
+    status = write_changed(pcf, PCF8563_MINUTE_ALARM, data, image, mask, PCF8563_ALARM_SIZE);
+    if (PCF8563_OK != status) {
+        return status;
+    }
 
-        /* 0..23 */
-        if (PCF8563_ALARM_DISABLE & data[1]) {
-            time->tm_hour = PCF8563_ALARM_NONE;
-        } else {
-            data[1] &= 0b00111111;
-            time->tm_hour = bcd2decimal(data[1]);
-        }
+    return pcf8563_alarm_next(now, &alarm, next);
+}
 
-        /* 1..31 */
-        if (PCF8563_ALARM_DISABLE & data[2]) {
-            time->tm_mday = PCF8563_ALARM_NONE;
-        } else {
-            data[2] &= 0b00111111;
-            time->tm_mday = bcd2decimal(data[2]);
+pcf8563_err_t pcf8563_configure(const pcf8563_t *pcf, const pcf8563_config_t *config)
+{
+    uint8_t data[PCF8563_CONFIG_SIZE] = {0};
+    uint8_t interrupts;
+    int32_t status;
+
+    /* Alarm, CLKOUT and timer registers are contiguous. */
+    pcf8563_alarm_to_raw(&config->alarm, data);
+    data[4] = config->clkout;
+    data[5] = config->timer_control;
+    data[6] = config->timer;
+
+    status = pcf->write(
+        pcf->handle, PCF8563_ADDRESS, PCF8563_MINUTE_ALARM, data, PCF8563_CONFIG_SIZE
+    );
+
+    if (PCF8563_OK != status || PCF8563_INTERRUPTS_KEEP == config->interrupts) {
+        return status;
+    }
+
+    /* This also clears any pending AF and TF flags. */
+    interrupts = config->interrupts & (PCF8563_AIE | PCF8563_TIE | PCF8563_TI_TP);
+
+    return pcf->write(
+        pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS2, &interrupts, 1
+    );
+}
+
+pcf8563_err_t pcf8563_snapshot(const pcf8563_t *pcf, pcf8563_snapshot_t *snapshot)
+{
+    uint8_t data[PCF8563_TIMER + 1] = {0};
+    int32_t status;
+
+    /* One burst is cheaper than two even if it includes the time. */
+    status = pcf->read(
+        pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS1, data, sizeof(data)
+    );
+
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    snapshot->data[0] = PCF8563_SNAPSHOT_VERSION;
+    snapshot->data[1] = data[PCF8563_CONTROL_STATUS1];
+    snapshot->data[2] = data[PCF8563_CONTROL_STATUS2];
+    for (uint8_t i = 0; i < PCF8563_CONFIG_SIZE; i++) {
+        snapshot->data[3 + i] = data[PCF8563_MINUTE_ALARM + i];
+    }
+    snapshot->data[10] = crc8(snapshot->data, 10);
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_restore(const pcf8563_t *pcf, const pcf8563_snapshot_t *snapshot)
+{
+    uint8_t control[2];
+    int32_t status;
+
+    if (PCF8563_SNAPSHOT_VERSION != snapshot->data[0]) {
+        return PCF8563_ERR_CHECKSUM;
+    }
+    if (crc8(snapshot->data, 10) != snapshot->data[10]) {
+        return PCF8563_ERR_CHECKSUM;
+    }
+
+    status = pcf->write(
+        pcf->handle, PCF8563_ADDRESS, PCF8563_MINUTE_ALARM, &snapshot->data[3], PCF8563_CONFIG_SIZE
+    );
+
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    /* Flags from the time of the snapshot are stale, clear them. */
+    control[0] = snapshot->data[1];
+    control[1] = snapshot->data[2] & ~(PCF8563_AF | PCF8563_TF);
+
+    return pcf->write(
+        pcf->handle, PCF8563_ADDRESS, PCF8563_CONTROL_STATUS1, control, 2
+    );
+}
+
+/* Two ASCII digits to one BCD byte, returns 0xff if not digits. */
+static uint8_t ascii2bcd(const char *ascii)
+{
+    uint8_t high = ascii[0] - '0';
+    uint8_t low = ascii[1] - '0';
+
+    if (high > 9 || low > 9) {
+        return 0xff;
+    }
+    return (high << 4) | low;
+}
+
+/*
+ * Parse "YYYY-MM-DDTHH:MM:SS" with optional trailing "Z" straight into the
+ * register image. Space is also accepted as date and time separator.
+ */
+pcf8563_err_t pcf8563_parse_iso8601(const char *string, uint8_t *raw)
+{
+    static const uint8_t days[13] = {
+        0x00, 0x31, 0x28, 0x31, 0x30, 0x31, 0x30, 0x31, 0x31, 0x30, 0x31, 0x30, 0x31
+    };
+    uint8_t century, year, month, day, hour, minute, second, last;
+    uint8_t leap;
+
+    for (uint8_t i = 0; i < 19; i++) {
+        if ('\0' == string[i]) {
+            return PCF8563_ERR_INVALID;
         }
+    }
 
-        /* 0..6 */
-        if (PCF8563_ALARM_DISABLE & data[3]) {
-            time->tm_wday = PCF8563_ALARM_NONE;
-        } else {
-            data[3] &= 0b00000111;
-            time->tm_wday = bcd2decimal(data[3]);
+    if ('-' != string[4] || '-' != string[7] || ':' != string[13] || ':' != string[16]) {
+        return PCF8563_ERR_INVALID;
+    }
+    if ('T' != string[10] && 't' != string[10] && ' ' != string[10]) {
+        return PCF8563_ERR_INVALID;
+    }
+    if ('\0' != string[19] && !(('Z' == string[19] || 'z' == string[19]) && '\0' == string[20])) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    century = ascii2bcd(string);
+    year = ascii2bcd(string + 2);
+    month = ascii2bcd(string + 5);
+    day = ascii2bcd(string + 8);
+    hour = ascii2bcd(string + 11);
+    minute = ascii2bcd(string + 14);
+    second = ascii2bcd(string + 17);
+
+    /* Invalid digits are 0xff and fail the range checks below. */
+    if (0x19 != century && 0x20 != century) {
+        return PCF8563_ERR_INVALID;
+    }
+    if (year > 0x99 || month < 0x01 || month > 0x12) {
+        return PCF8563_ERR_INVALID;
+    }
+    if (hour > 0x23 || minute > 0x59 || second > 0x59) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    /* Year divisible by four, 2000 is a leap year but 1900 is not. */
+    leap = 0 == ((((year >> 4) << 1) + (year & 0x0f)) & 0b00000011);
+    if (0x19 == century && 0x00 == year) {
+        leap = 0;
+    }
+
+    last = days[pcf8563_bcd2decimal(month)];
+    if (0x02 == month && leap) {
+        last = 0x29;
+    }
+    if (day < 0x01 || day > last) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    raw[0] = second;
+    raw[1] = minute;
+    raw[2] = hour;
+    raw[3] = day;
+    raw[4] = weekday_from_days(days_from_civil(
+        (0x20 == century ? 2000 : 1900) + pcf8563_bcd2decimal(year),
+        pcf8563_bcd2decimal(month),
+        pcf8563_bcd2decimal(day)
+    ));
+    raw[5] = month;
+    if (0x20 == century) {
+        raw[5] |= PCF8563_CENTURY_BIT;
+    }
+    raw[6] = year;
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_epoch_to_raw(int64_t epoch, uint8_t *raw)
+{
+    /* 1900-01-01 00:00:00 and 2100-01-01 00:00:00 UTC */
+    if (epoch < -2208988800LL || epoch >= 4102444800LL) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    datetime2registers(pcf8563_datetime_from_epoch(epoch), raw);
+
+    return PCF8563_OK;
+}
+
+/*
+ * Each BCD nibble maps directly to an ASCII digit so formatting needs
+ * only masks, shifts and ORs.
+ */
+void pcf8563_format_iso8601(const uint8_t *raw, char *buffer)
+{
+    uint8_t century = raw[5] & PCF8563_CENTURY_BIT;
+
+    buffer[0] = century ? '2' : '1';
+    buffer[1] = century ? '0' : '9';
+    buffer[2] = '0' | (raw[6] >> 4);
+    buffer[3] = '0' | (raw[6] & 0x0f);
+    buffer[4] = '-';
+    buffer[5] = '0' | ((raw[5] >> 4) & 0b00000001);
+    buffer[6] = '0' | (raw[5] & 0x0f);
+    buffer[7] = '-';
+    buffer[8] = '0' | ((raw[3] >> 4) & 0b00000011);
+    buffer[9] = '0' | (raw[3] & 0x0f);
+    buffer[10] = 'T';
+    buffer[11] = '0' | ((raw[2] >> 4) & 0b00000011);
+    buffer[12] = '0' | (raw[2] & 0x0f);
+    buffer[13] = ':';
+    buffer[14] = '0' | ((raw[1] >> 4) & 0b00000111);
+    buffer[15] = '0' | (raw[1] & 0x0f);
+    buffer[16] = ':';
+    buffer[17] = '0' | ((raw[0] >> 4) & 0b00000111);
+    buffer[18] = '0' | (raw[0] & 0x0f);
+    buffer[19] = '\0';
+}
+
+/* Count consecutive register images into PCF8563_ISO8601_SIZE byte slots. */
+void pcf8563_format_iso8601_batch(const uint8_t *raw, char *buffer, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        pcf8563_format_iso8601(raw, buffer);
+        raw += PCF8563_TIME_SIZE;
+        buffer += PCF8563_ISO8601_SIZE;
+    }
+}
+
+pcf8563_err_t pcf8563_ioctl(const pcf8563_t *pcf, int16_t command, void *buffer)
+{
+    uint8_t reg = command >> 8;
+    uint8_t data[PCF8563_ALARM_SIZE] = {0};
+    int32_t status;
+
+    switch (command) {
+    case PCF8563_ALARM_SET:
+        pcf8563_alarm_to_raw((const struct tm *)buffer, data);
+
+        return pcf->write(
+            pcf->handle, PCF8563_ADDRESS, reg, data, PCF8563_ALARM_SIZE
+        );
+
+        break;
+
+    case PCF8563_ALARM_READ:
+        status = pcf->read(
+            pcf->handle, PCF8563_ADDRESS, reg, data, PCF8563_ALARM_SIZE
+        );
+
+        if (PCF8563_OK != status) {
+            return status;
         }
 
+        pcf8563_raw_to_alarm(data, (struct tm *)buffer);
+
         return PCF8563_OK;
         break;
 
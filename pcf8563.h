@@ -70,6 +70,17 @@ extern "C" {
 #define PCF8563_ALARM_NONE       (0xff)
 #define PCF8563_ALARM_SIZE       (0x04)
 
+/* Unrestricted day of month or weekday field in pcf8563_cron_t. */
+#define PCF8563_CRON_ANY_DAY     (0b00000001)
+#define PCF8563_CRON_ANY_WEEKDAY (0b00000010)
+
+#define PCF8563_CLKOUT_CONTROL   (0x0d)
+#define PCF8563_CLKOUT_ENABLE    (0b10000000)
+#define PCF8563_CLKOUT_32768HZ   (0b00000000)
+#define PCF8563_CLKOUT_1024HZ    (0b00000001)
+#define PCF8563_CLKOUT_32HZ      (0b00000010)
+#define PCF8563_CLKOUT_1HZ       (0b00000011)
+
 #define PCF8563_TIMER_CONTROL    (0x0e)
 #define PCF8563_TIMER_ENABLE     (0b10000000)
 #define PCF8563_TIMER_4_096KHZ   (0b00000000)
@@ -78,6 +89,21 @@ extern "C" {
 #define PCF8563_TIMER_1_60HZ     (0b00000011)
 #define PCF8563_TIMER            (0x0f)
 
+/* Alarm, CLKOUT and timer registers 0x09..0x0f. */
+#define PCF8563_CONFIG_SIZE      (0x07)
+#define PCF8563_INTERRUPTS_KEEP  (0xff)
+
+/* "YYYY-MM-DDTHH:MM:SS" and terminating NUL. */
+#define PCF8563_ISO8601_SIZE     (20)
+
+/* Version, control, alarm, CLKOUT and timer registers and checksum. */
+#define PCF8563_SNAPSHOT_SIZE    (0x0b)
+#define PCF8563_SNAPSHOT_VERSION (0x01)
+
+/* Registers 0x00..0x0f read by pcf8563_poll_plan(). */
+#define PCF8563_POLL_SIZE        (0x10)
+#define PCF8563_POLL_NEVER       (UINT64_MAX)
+
 /* IOCTL commands */
 #define PCF8563_ALARM_SET        (0x0900)
 #define PCF8563_ALARM_READ       (0x0901)
@@ -94,6 +120,15 @@ extern "C" {
 #define PCF8563_ERROR_NOTTY      (-1)
 #define PCF8563_OK               (0x00)
 #define PCF8563_ERR_LOW_VOLTAGE  (0x80)
+#define PCF8563_ERR_CHECKSUM     (0x81)
+#define PCF8563_ERR_INVALID      (0x82)
+#define PCF8563_ERR_STALE        (0x83)
+#define PCF8563_ERR_THREAD       (0x84)
+/* Returned by the modules in posix/. */
+#define PCF8563_ERR_NO_DATA          (0x90)
+#define PCF8563_ERR_DEADLINE         (0x91)
+#define PCF8563_ERR_REPLAY_END       (0x92)
+#define PCF8563_ERR_REPLAY_MISMATCH  (0x93)
 
 /* These should be provided by the HAL. */
 typedef struct {
@@ -104,9 +139,202 @@ typedef struct {
 
 typedef int32_t pcf8563_err_t;
 
+typedef struct {
+    /* tm_min, tm_hour, tm_mday and tm_wday or PCF8563_ALARM_NONE. */
+    struct tm alarm;
+    uint8_t clkout;
+    uint8_t timer_control;
+    uint8_t timer;
+    /* PCF8563_AIE, PCF8563_TIE, PCF8563_TI_TP or PCF8563_INTERRUPTS_KEEP. */
+    uint8_t interrupts;
+} pcf8563_config_t;
+
+/* Serialisable copy of all non-time registers. */
+typedef struct {
+    uint8_t data[PCF8563_SNAPSHOT_SIZE];
+} pcf8563_snapshot_t;
+
+/* Compiled cron expression, bit n is set when value n matches. */
+typedef struct {
+    uint64_t minutes;
+    uint32_t hours;
+    uint32_t days;
+    uint16_t months;
+    uint8_t weekdays;
+    uint8_t flags;
+} pcf8563_cron_t;
+
+/*
+ * AF and TF cannot be set before earliest_us and will be set by latest_us
+ * microseconds from the read, PCF8563_POLL_NEVER if nothing is armed.
+ */
+typedef struct {
+    uint8_t flags;
+    uint64_t earliest_us;
+    uint64_t latest_us;
+} pcf8563_poll_t;
+
+/*
+ * Accessors for the raw PCF8563_TIME_SIZE byte register image returned by
+ * pcf8563_read_raw(). Each decodes only the field it is asked for.
+ */
+static inline uint8_t pcf8563_bcd2decimal(uint8_t bcd)
+{
+    return (((bcd >> 4) * 10) + (bcd & 0x0f));
+}
+
+/* 0..59 */
+static inline uint8_t pcf8563_raw_seconds(const uint8_t *buffer)
+{
+    return pcf8563_bcd2decimal(buffer[0] & 0b01111111);
+}
+
+/* 0..59 */
+static inline uint8_t pcf8563_raw_minutes(const uint8_t *buffer)
+{
+    return pcf8563_bcd2decimal(buffer[1] & 0b01111111);
+}
+
+/* 0..23 */
+static inline uint8_t pcf8563_raw_hours(const uint8_t *buffer)
+{
+    return pcf8563_bcd2decimal(buffer[2] & 0b00111111);
+}
+
+/* 1..31 */
+static inline uint8_t pcf8563_raw_day(const uint8_t *buffer)
+{
+    return pcf8563_bcd2decimal(buffer[3] & 0b00111111);
+}
+
+/* 0..6 */
+static inline uint8_t pcf8563_raw_weekday(const uint8_t *buffer)
+{
+    return buffer[4] & 0b00000111;
+}
+
+/* 1..12 */
+static inline uint8_t pcf8563_raw_month(const uint8_t *buffer)
+{
+    return pcf8563_bcd2decimal(buffer[5] & 0b00011111);
+}
+
+/* 1900..2099, if century bit set assume it is 2000. */
+static inline uint16_t pcf8563_raw_year(const uint8_t *buffer)
+{
+    uint16_t century = (buffer[5] & PCF8563_CENTURY_BIT) ? 2000 : 1900;
+    return century + pcf8563_bcd2decimal(buffer[6]);
+}
+
+static inline uint8_t pcf8563_raw_low_voltage(const uint8_t *buffer)
+{
+    return (buffer[0] & 0b10000000) ? 1 : 0;
+}
+
+/*
+ * Packed date and time. Fields are stored most significant first so that
+ * two values can be ordered with a single integer comparison.
+ *
+ * 63..48 year, 47..40 month 1..12, 39..32 day 1..31, 31..24 hour 0..23,
+ * 23..16 minute 0..59, 15..8 second 0..59, 7..0 weekday 0..6
+ */
+typedef uint64_t pcf8563_datetime_t;
+
+/*
+ * Epochs of 0000-01-01 00:00:00 and 9999-12-31 23:59:59 UTC. Epochs outside
+ * are clamped by pcf8563_datetime_from_epoch().
+ */
+#define PCF8563_DATETIME_EPOCH_MIN  (-62167219200LL)
+#define PCF8563_DATETIME_EPOCH_MAX  (253402300799LL)
+
+#define PCF8563_DATETIME(year, month, day, hour, minute, second, weekday) \
+    (((uint64_t)(year) << 48) | ((uint64_t)(month) << 40) | \
+    ((uint64_t)(day) << 32) | ((uint64_t)(hour) << 24) | \
+    ((uint64_t)(minute) << 16) | ((uint64_t)(second) << 8) | \
+    (uint64_t)(weekday))
+
+static inline uint16_t pcf8563_datetime_year(pcf8563_datetime_t datetime)
+{
+    return datetime >> 48;
+}
+
+static inline uint8_t pcf8563_datetime_month(pcf8563_datetime_t datetime)
+{
+    return datetime >> 40;
+}
+
+static inline uint8_t pcf8563_datetime_day(pcf8563_datetime_t datetime)
+{
+    return datetime >> 32;
+}
+
+static inline uint8_t pcf8563_datetime_hour(pcf8563_datetime_t datetime)
+{
+    return datetime >> 24;
+}
+
+static inline uint8_t pcf8563_datetime_minute(pcf8563_datetime_t datetime)
+{
+    return datetime >> 16;
+}
+
+static inline uint8_t pcf8563_datetime_second(pcf8563_datetime_t datetime)
+{
+    return datetime >> 8;
+}
+
+static inline uint8_t pcf8563_datetime_weekday(pcf8563_datetime_t datetime)
+{
+    return datetime;
+}
+
+/* Returns -1, 0 or 1. Weekday is not part of the comparison. */
+static inline int pcf8563_datetime_compare(pcf8563_datetime_t a, pcf8563_datetime_t b)
+{
+    return ((a >> 8) > (b >> 8)) - ((a >> 8) < (b >> 8));
+}
+
+static inline pcf8563_datetime_t pcf8563_raw_to_datetime(const uint8_t *buffer)
+{
+    return PCF8563_DATETIME(
+        pcf8563_raw_year(buffer), pcf8563_raw_month(buffer),
+        pcf8563_raw_day(buffer), pcf8563_raw_hours(buffer),
+        pcf8563_raw_minutes(buffer), pcf8563_raw_seconds(buffer),
+        pcf8563_raw_weekday(buffer)
+    );
+}
+
 pcf8563_err_t pcf8563_init(const pcf8563_t *pcf);
+pcf8563_err_t pcf8563_init_warm(const pcf8563_t *pcf);
 pcf8563_err_t pcf8563_read(const pcf8563_t *pcf, struct tm *time);
+pcf8563_err_t pcf8563_read_raw(const pcf8563_t *pcf, uint8_t *buffer);
+pcf8563_err_t pcf8563_raw_to_tm(const uint8_t *buffer, struct tm *time);
+void pcf8563_tm_to_raw(const struct tm *time, uint8_t *buffer);
+void pcf8563_alarm_to_raw(const struct tm *time, uint8_t *buffer);
+void pcf8563_raw_to_alarm(const uint8_t *buffer, struct tm *time);
+pcf8563_err_t pcf8563_alarm_next(const struct tm *now, const struct tm *alarm, struct tm *next);
+void pcf8563_poll_plan_raw(const uint8_t *raw, pcf8563_poll_t *plan);
+pcf8563_err_t pcf8563_poll_plan(const pcf8563_t *pcf, pcf8563_poll_t *plan);
+pcf8563_err_t pcf8563_cron_compile(const char *expression, pcf8563_cron_t *cron);
+pcf8563_err_t pcf8563_cron_next(const pcf8563_cron_t *cron, const struct tm *now, struct tm *next);
+pcf8563_err_t pcf8563_cron_arm(const pcf8563_t *pcf, const pcf8563_cron_t *cron, const struct tm *now, struct tm *next, uint8_t *image);
 pcf8563_err_t pcf8563_write(const pcf8563_t *pcf, const struct tm *time);
+pcf8563_err_t pcf8563_write_raw(const pcf8563_t *pcf, const uint8_t *buffer);
+pcf8563_err_t pcf8563_write_diff(const pcf8563_t *pcf, const struct tm *time, uint8_t *image);
+pcf8563_err_t pcf8563_read_datetime(const pcf8563_t *pcf, pcf8563_datetime_t *datetime);
+pcf8563_err_t pcf8563_write_datetime(const pcf8563_t *pcf, pcf8563_datetime_t datetime);
+pcf8563_datetime_t pcf8563_datetime_from_tm(const struct tm *time);
+void pcf8563_datetime_to_tm(pcf8563_datetime_t datetime, struct tm *time);
+int64_t pcf8563_datetime_to_epoch(pcf8563_datetime_t datetime);
+pcf8563_datetime_t pcf8563_datetime_from_epoch(int64_t epoch);
+int64_t pcf8563_datetime_diff(pcf8563_datetime_t a, pcf8563_datetime_t b);
+pcf8563_err_t pcf8563_configure(const pcf8563_t *pcf, const pcf8563_config_t *config);
+pcf8563_err_t pcf8563_snapshot(const pcf8563_t *pcf, pcf8563_snapshot_t *snapshot);
+pcf8563_err_t pcf8563_restore(const pcf8563_t *pcf, const pcf8563_snapshot_t *snapshot);
+pcf8563_err_t pcf8563_parse_iso8601(const char *string, uint8_t *raw);
+pcf8563_err_t pcf8563_epoch_to_raw(int64_t epoch, uint8_t *raw);
+void pcf8563_format_iso8601(const uint8_t *raw, char *buffer);
+void pcf8563_format_iso8601_batch(const uint8_t *raw, char *buffer, uint32_t count);
 pcf8563_err_t pcf8563_ioctl(const pcf8563_t *pcf, int16_t command, void *buffer);
 pcf8563_err_t pcf8563_close(const pcf8563_t *pcf);
 
@@ -0,0 +1,362 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_ASYNC_HPP
+#define _PCF8563_ASYNC_HPP
+
+#include <coroutine>
+#include <cstdint>
+#include <ctime>
+#include <exception>
+#include <functional>
+#include <map>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "pcf8563.h"
+
+/*
+ * Non-blocking HAL. Functions start the transfer and return immediately.
+ * When the transfer completes done(context, status) must be called from
+ * the thread which runs the executor.
+ */
+typedef void (* pcf8563_async_done_t)(void *context, int32_t status);
+
+typedef struct {
+    void (* read)(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size, pcf8563_async_done_t done, void *context);
+    void (* write)(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size, pcf8563_async_done_t done, void *context);
+    void *handle;
+} pcf8563_async_t;
+
+/* Fire and forget coroutine type. Started and owned by pcf8563_executor. */
+class pcf8563_task {
+public:
+    struct promise_type {
+        pcf8563_task get_return_object() noexcept
+        {
+            return pcf8563_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    pcf8563_task(pcf8563_task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    pcf8563_task(const pcf8563_task &) = delete;
+    pcf8563_task &operator=(const pcf8563_task &) = delete;
+
+    pcf8563_task &operator=(pcf8563_task &&other) noexcept
+    {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~pcf8563_task()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool done() const noexcept
+    {
+        return !handle || handle.done();
+    }
+
+private:
+    friend class pcf8563_executor;
+
+    explicit pcf8563_task(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/*
+ * Minimal single threaded executor with a virtual clock. Timers do not
+ * sleep, instead the clock jumps to the next due timer when there is
+ * nothing else to run.
+ */
+class pcf8563_executor {
+public:
+    void spawn(pcf8563_task task)
+    {
+        ready.push(task.handle);
+        tasks.push_back(std::move(task));
+    }
+
+    void post(std::coroutine_handle<> handle)
+    {
+        ready.push(handle);
+    }
+
+    void call_at(uint64_t time_us, std::function<void()> callback)
+    {
+        timers.emplace(time_us, std::move(callback));
+    }
+
+    void call_later(uint64_t delay_us, std::function<void()> callback)
+    {
+        call_at(clock_us + delay_us, std::move(callback));
+    }
+
+    /* Virtual time in microseconds. */
+    uint64_t now() const noexcept
+    {
+        return clock_us;
+    }
+
+    /* Sleep in virtual time, usage: co_await executor.sleep(1000); */
+    auto sleep(uint64_t delay_us)
+    {
+        struct awaiter {
+            pcf8563_executor *executor;
+            uint64_t delay_us;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                pcf8563_executor *self = executor;
+                self->call_later(delay_us, [self, handle]() { self->post(handle); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{this, delay_us};
+    }
+
+    /* Run until all tasks are finished or nothing can make progress. */
+    void run()
+    {
+        for (;;) {
+            while (!ready.empty()) {
+                std::coroutine_handle<> handle = ready.front();
+                ready.pop();
+                handle.resume();
+            }
+
+            if (timers.empty()) {
+                break;
+            }
+
+            /* Nothing ready, jump to the next timer. */
+            std::multimap<uint64_t, std::function<void()>>::iterator timer = timers.begin();
+            std::function<void()> callback = std::move(timer->second);
+            clock_us = timer->first;
+            timers.erase(timer);
+            callback();
+        }
+
+        std::erase_if(tasks, [](const pcf8563_task &task) { return task.done(); });
+    }
+
+private:
+    std::queue<std::coroutine_handle<>> ready;
+    std::multimap<uint64_t, std::function<void()>> timers;
+    std::vector<pcf8563_task> tasks;
+    uint64_t clock_us = 0;
+};
+
+/*
+ * Awaitable RTC operations, for example:
+ *
+ *     struct tm time;
+ *     pcf8563_err_t status = co_await rtc.read(&time);
+ */
+class pcf8563_async {
+private:
+    /* Single register transfer, subclasses decode the result. */
+    class transfer {
+    public:
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            waiting = handle;
+            if (write) {
+                hal->write(hal->handle, PCF8563_ADDRESS, reg, data, size, &transfer::done, this);
+            } else {
+                hal->read(hal->handle, PCF8563_ADDRESS, reg, data, size, &transfer::done, this);
+            }
+        }
+
+        pcf8563_err_t await_resume() const noexcept
+        {
+            return status;
+        }
+
+    protected:
+        transfer(const pcf8563_async_t *hal, bool write, uint8_t reg, uint16_t size)
+            : hal(hal), write(write), reg(reg), size(size) {}
+
+        static void done(void *context, int32_t status)
+        {
+            transfer *self = static_cast<transfer *>(context);
+            self->status = status;
+            self->waiting.resume();
+        }
+
+        const pcf8563_async_t *hal;
+        bool write;
+        uint8_t reg;
+        uint16_t size;
+        uint8_t data[PCF8563_TIME_SIZE] = {0};
+        pcf8563_err_t status = PCF8563_OK;
+        std::coroutine_handle<> waiting;
+    };
+
+    class read_transfer : public transfer {
+    public:
+        read_transfer(const pcf8563_async_t *hal, struct tm *time)
+            : transfer(hal, false, PCF8563_SECONDS, PCF8563_TIME_SIZE), time(time) {}
+
+        pcf8563_err_t await_resume() const noexcept
+        {
+            if (PCF8563_OK != status) {
+                return status;
+            }
+            return pcf8563_raw_to_tm(data, time);
+        }
+
+    private:
+        struct tm *time;
+    };
+
+    class write_transfer : public transfer {
+    public:
+        write_transfer(const pcf8563_async_t *hal, const struct tm *time)
+            : transfer(hal, true, PCF8563_SECONDS, PCF8563_TIME_SIZE)
+        {
+            pcf8563_tm_to_raw(time, data);
+        }
+    };
+
+    class alarm_set_transfer : public transfer {
+    public:
+        alarm_set_transfer(const pcf8563_async_t *hal, const struct tm *time)
+            : transfer(hal, true, PCF8563_MINUTE_ALARM, PCF8563_ALARM_SIZE)
+        {
+            pcf8563_alarm_to_raw(time, data);
+        }
+    };
+
+    class alarm_read_transfer : public transfer {
+    public:
+        alarm_read_transfer(const pcf8563_async_t *hal, struct tm *time)
+            : transfer(hal, false, PCF8563_MINUTE_ALARM, PCF8563_ALARM_SIZE), time(time) {}
+
+        pcf8563_err_t await_resume() const noexcept
+        {
+            if (PCF8563_OK == status) {
+                pcf8563_raw_to_alarm(data, time);
+            }
+            return status;
+        }
+
+    private:
+        struct tm *time;
+    };
+
+    /* Timer control and timer registers are adjacent. */
+    class timer_write_transfer : public transfer {
+    public:
+        timer_write_transfer(const pcf8563_async_t *hal, uint8_t control, uint8_t count)
+            : transfer(hal, true, PCF8563_TIMER_CONTROL, 2)
+        {
+            data[0] = control;
+            data[1] = count;
+        }
+    };
+
+    class timer_read_transfer : public transfer {
+    public:
+        timer_read_transfer(const pcf8563_async_t *hal, uint8_t *control, uint8_t *count)
+            : transfer(hal, false, PCF8563_TIMER_CONTROL, 2), control(control), count(count) {}
+
+        pcf8563_err_t await_resume() const noexcept
+        {
+            if (PCF8563_OK == status) {
+                *control = data[0];
+                *count = data[1];
+            }
+            return status;
+        }
+
+    private:
+        uint8_t *control;
+        uint8_t *count;
+    };
+
+public:
+    explicit pcf8563_async(const pcf8563_async_t *hal) : hal(hal) {}
+
+    read_transfer read(struct tm *time) const
+    {
+        return read_transfer(hal, time);
+    }
+
+    write_transfer write(const struct tm *time) const
+    {
+        return write_transfer(hal, time);
+    }
+
+    alarm_set_transfer alarm_set(const struct tm *time) const
+    {
+        return alarm_set_transfer(hal, time);
+    }
+
+    alarm_read_transfer alarm_read(struct tm *time) const
+    {
+        return alarm_read_transfer(hal, time);
+    }
+
+    timer_write_transfer timer_write(uint8_t control, uint8_t count) const
+    {
+        return timer_write_transfer(hal, control, count);
+    }
+
+    timer_read_transfer timer_read(uint8_t *control, uint8_t *count) const
+    {
+        return timer_read_transfer(hal, control, count);
+    }
+
+private:
+    const pcf8563_async_t *hal;
+};
+
+#endif
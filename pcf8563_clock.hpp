@@ -0,0 +1,136 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_CLOCK_HPP
+#define _PCF8563_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+#include "pcf8563.h"
+
+/*
+ * TrivialClock backed by the RTC. The time is anchored to the RTC with
+ * sync() and extrapolated using std::chrono::steady_clock in between, so
+ * now() never touches the bus. RTC is assumed to be in UTC.
+ */
+class pcf8563_clock {
+public:
+    typedef std::chrono::nanoseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<pcf8563_clock> time_point;
+
+    static constexpr bool is_steady = false;
+
+    static time_point now() noexcept
+    {
+        return time_point(duration(
+            std::chrono::steady_clock::now().time_since_epoch().count() +
+            offset().load(std::memory_order_relaxed)
+        ));
+    }
+
+    /*
+     * Read the RTC and re-anchor the clock. When wait_for_edge is true the
+     * RTC is polled until the seconds change, which anchors to the second
+     * boundary instead of somewhere within the second. If the seconds do
+     * not change within two seconds PCF8563_ERR_STALE is returned and the
+     * clock is left as it was.
+     */
+    static pcf8563_err_t sync(const pcf8563_t *pcf, bool wait_for_edge = false)
+    {
+        uint8_t raw[PCF8563_TIME_SIZE];
+        uint8_t seconds;
+        pcf8563_err_t status;
+
+        status = pcf8563_read_raw(pcf, raw);
+        if (PCF8563_OK != status) {
+            return status;
+        }
+
+        if (wait_for_edge) {
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            seconds = raw[0];
+            do {
+                if (std::chrono::steady_clock::now() - start > std::chrono::seconds(2)) {
+                    /* Clock is not running. */
+                    return PCF8563_ERR_STALE;
+                }
+                status = pcf8563_read_raw(pcf, raw);
+                if (PCF8563_OK != status) {
+                    return status;
+                }
+            } while (seconds == raw[0]);
+        }
+
+        std::int64_t steady = std::chrono::duration_cast<duration>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+        std::int64_t rtc = pcf8563_datetime_to_epoch(
+            pcf8563_raw_to_datetime(raw)
+        ) * 1000000000;
+
+        offset().store(rtc - steady, std::memory_order_relaxed);
+
+        if (pcf8563_raw_low_voltage(raw)) {
+            return PCF8563_ERR_LOW_VOLTAGE;
+        }
+        return PCF8563_OK;
+    }
+
+    static std::time_t to_time_t(const time_point &time) noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            time.time_since_epoch()
+        ).count();
+    }
+
+    static time_point from_time_t(std::time_t time) noexcept
+    {
+        return time_point(std::chrono::seconds(time));
+    }
+
+private:
+    /* Difference between RTC and steady_clock in nanoseconds. */
+    static std::atomic<std::int64_t> &offset() noexcept
+    {
+        static std::atomic<std::int64_t> value(0);
+        return value;
+    }
+};
+
+#endif
@@ -0,0 +1,184 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pcf8563.h"
+#include "pcf8563_health.h"
+
+static void flag(pcf8563_health_t *health, uint8_t bit, uint32_t *events)
+{
+    if (!(health->state & bit)) {
+        health->state |= bit;
+        (*events)++;
+    }
+}
+
+static void control(pcf8563_health_t *health, uint8_t value)
+{
+    if (value & PCF8563_STOP) {
+        flag(health, PCF8563_HEALTH_STOPPED, &health->stop_events);
+    } else {
+        health->state &= ~PCF8563_HEALTH_STOPPED;
+    }
+}
+
+/* Masks of seconds, minutes and hours and how often they wrap around. */
+static const uint8_t masks[] = {0b01111111, 0b01111111, 0b00111111};
+static const uint32_t wraps_s[] = {60, 3600, 86400};
+
+static void advance(pcf8563_health_t *health, const uint8_t *time, uint8_t count, uint64_t now)
+{
+    uint64_t elapsed = now - health->changed_ms;
+    uint32_t value = 0;
+    uint8_t common;
+
+    if (time[0] & 0b10000000) {
+        flag(health, PCF8563_HEALTH_LOW_VOLTAGE, &health->low_voltage_events);
+    } else {
+        health->state &= ~PCF8563_HEALTH_LOW_VOLTAGE;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        value |= (uint32_t)(time[i] & masks[i]) << (8 * i);
+    }
+
+    /* Reads of different length are compared on what both include. */
+    common = count < health->count ? count : health->count;
+
+    if (!health->seen || (value ^ health->time) & (0xffffffff >> (32 - 8 * common))) {
+        health->seen = 1;
+        health->time = value;
+        health->count = count;
+        health->changed_ms = now;
+        health->state &= ~PCF8563_HEALTH_STALLED;
+        return;
+    }
+    health->time = value;
+    health->count = count;
+
+    /*
+     * Same value again. If the reads are far enough apart the registers
+     * compared could have wrapped around, in that case start over from
+     * this read. With seconds only that limits detection to reads less
+     * than 55 seconds apart.
+     */
+    if (elapsed + 5000 >= wraps_s[common - 1] * 1000ULL) {
+        health->changed_ms = now;
+    } else if (elapsed >= health->stall_ms) {
+        flag(health, PCF8563_HEALTH_STALLED, &health->stall_events);
+    }
+}
+
+pcf8563_err_t pcf8563_health_init(pcf8563_health_t *health, const pcf8563_t *hal, pcf8563_health_millis_t millis)
+{
+    memset(health, 0, sizeof(pcf8563_health_t));
+
+    health->hal = hal;
+    health->millis = millis;
+    health->stall_ms = PCF8563_HEALTH_STALL_MS;
+    health->interval_ms = PCF8563_HEALTH_INTERVAL_MS;
+
+    return PCF8563_OK;
+}
+
+int32_t pcf8563_health_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    pcf8563_health_t *health = handle;
+    const pcf8563_t *hal = health->hal;
+    uint8_t wide[PCF8563_TIMER + 1];
+    uint16_t end = reg + size;
+    uint64_t now;
+    int32_t status;
+
+    /* Only reads which include the seconds register are of interest. */
+    if (PCF8563_ADDRESS != address || reg > PCF8563_SECONDS || end <= PCF8563_SECONDS) {
+        return hal->read(hal->handle, address, reg, buffer, size);
+    }
+
+    now = health->millis();
+    health->reads++;
+
+    if (reg > PCF8563_CONTROL_STATUS1 && end <= sizeof(wide) &&
+        (0 == health->checks || now - health->checked_ms >= health->interval_ms)) {
+        status = hal->read(hal->handle, address, PCF8563_CONTROL_STATUS1, wide, end);
+        if (PCF8563_OK != status) {
+            return status;
+        }
+        memcpy(buffer, wide + reg, size);
+        reg = PCF8563_CONTROL_STATUS1;
+        buffer = wide;
+    } else {
+        status = hal->read(hal->handle, address, reg, buffer, size);
+        if (PCF8563_OK != status) {
+            return status;
+        }
+    }
+
+    if (PCF8563_CONTROL_STATUS1 == reg) {
+        health->checks++;
+        health->checked_ms = now;
+        control(health, buffer[0]);
+    }
+    advance(
+        health, buffer + PCF8563_SECONDS - reg,
+        end > PCF8563_HOURS ? 3 : end - PCF8563_SECONDS, now
+    );
+
+    return PCF8563_OK;
+}
+
+int32_t pcf8563_health_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    pcf8563_health_t *health = handle;
+    const pcf8563_t *hal = health->hal;
+    int32_t status;
+
+    status = hal->write(hal->handle, address, reg, buffer, size);
+    if (PCF8563_OK != status || PCF8563_ADDRESS != address) {
+        return status;
+    }
+
+    if (PCF8563_CONTROL_STATUS1 == reg && size > 0) {
+        control(health, buffer[0]);
+    }
+
+    /* Setting the time clears VL and restarts the stall detection. */
+    if (reg <= PCF8563_SECONDS && reg + size > PCF8563_SECONDS) {
+        health->state &= ~(PCF8563_HEALTH_LOW_VOLTAGE | PCF8563_HEALTH_STALLED);
+        health->seen = 0;
+    }
+
+    return PCF8563_OK;
+}
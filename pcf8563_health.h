@@ -0,0 +1,98 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_HEALTH_H
+#define _PCF8563_HEALTH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "pcf8563.h"
+
+/* Health state bits, 0 is healthy. */
+#define PCF8563_HEALTH_LOW_VOLTAGE   (0b00000001)
+#define PCF8563_HEALTH_STALLED       (0b00000010)
+#define PCF8563_HEALTH_STOPPED       (0b00000100)
+
+/* Defaults for the thresholds in pcf8563_health_t. */
+#define PCF8563_HEALTH_STALL_MS      (2500)
+#define PCF8563_HEALTH_INTERVAL_MS   (60000)
+
+/* Monotonic host time in milliseconds. */
+typedef uint64_t (* pcf8563_health_millis_t)(void);
+
+/*
+ * Watches the traffic of a HAL. Reads of the seconds register tell if the
+ * clock advances and if VL is set. Minutes and hours are compared too when
+ * the read includes them, seconds alone can only detect a stall between
+ * reads less than a minute apart. Once per interval such a read is
+ * widened to start from CONTROL_STATUS1 to catch the STOP bit, which costs
+ * two bytes but no extra transaction. Writes of CONTROL_STATUS1 and the
+ * seconds register are tracked too.
+ */
+typedef struct {
+    const pcf8563_t *hal;
+    pcf8563_health_millis_t millis;
+    uint32_t stall_ms;
+    uint32_t interval_ms;
+
+    uint8_t state;
+    uint8_t seen;
+    /* Seconds, minutes and hours from the latest read, count of them. */
+    uint32_t time;
+    uint8_t count;
+    uint64_t changed_ms;
+    uint64_t checked_ms;
+
+    /* Number of times each problem appeared. */
+    uint32_t low_voltage_events;
+    uint32_t stall_events;
+    uint32_t stop_events;
+    /* Number of reads observed and widened. */
+    uint32_t reads;
+    uint32_t checks;
+} pcf8563_health_t;
+
+pcf8563_err_t pcf8563_health_init(pcf8563_health_t *health, const pcf8563_t *hal, pcf8563_health_millis_t millis);
+
+/* HAL functions for pcf8563_t, handle must point to pcf8563_health_t. */
+int32_t pcf8563_health_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t pcf8563_health_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,198 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <stdint.h>
+
+#include "pcf8563.h"
+#include "pcf8563_hires.h"
+
+typedef struct {
+    int64_t seconds;
+    /* Timer position before and after the time registers were latched. */
+    uint8_t before;
+    uint8_t after;
+} hires_sample_t;
+
+/*
+ * Timer position is read both before and after the burst which latches
+ * the time registers. Their order tells whether the timer wrapped and
+ * which second boundaries could have been crossed in between.
+ */
+static pcf8563_err_t sample(const pcf8563_t *pcf, hires_sample_t *result)
+{
+    uint8_t raw[PCF8563_TIMER - PCF8563_SECONDS + 1];
+    uint8_t count;
+    int32_t status;
+
+    status = pcf->read(pcf->handle, PCF8563_ADDRESS, PCF8563_TIMER, &count, 1);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    status = pcf->read(pcf->handle, PCF8563_ADDRESS, PCF8563_SECONDS, raw, sizeof(raw));
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    result->seconds = pcf8563_datetime_to_epoch(pcf8563_raw_to_datetime(raw));
+    result->before = (PCF8563_HIRES_RELOAD - count) % PCF8563_HIRES_RELOAD;
+    result->after = (PCF8563_HIRES_RELOAD - raw[sizeof(raw) - 1]) % PCF8563_HIRES_RELOAD;
+
+    return PCF8563_OK;
+}
+
+/* Ticks from position from to position to, both modulo the reload. */
+static uint8_t distance(uint8_t from, uint8_t to)
+{
+    return (to - from + PCF8563_HIRES_RELOAD) % PCF8563_HIRES_RELOAD;
+}
+
+pcf8563_err_t pcf8563_hires_start(pcf8563_hires_t *hires, const pcf8563_t *pcf, pcf8563_hires_millis_t millis)
+{
+    const uint8_t data[2] = {
+        PCF8563_TIMER_ENABLE | PCF8563_TIMER_4_096KHZ, PCF8563_HIRES_RELOAD
+    };
+    int32_t status;
+
+    hires->pcf = pcf;
+    hires->millis = millis;
+    hires->calibrated = 0;
+    hires->retries = 0;
+
+    /* Timer control and timer in one burst. */
+    status = pcf->write(pcf->handle, PCF8563_ADDRESS, PCF8563_TIMER_CONTROL, data, 2);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    return pcf8563_hires_calibrate(hires);
+}
+
+/*
+ * Find the timer position at the second boundary by reading until the
+ * seconds register changes. Takes up to one second.
+ */
+pcf8563_err_t pcf8563_hires_calibrate(pcf8563_hires_t *hires)
+{
+    hires_sample_t previous, current;
+    uint64_t start = hires->millis();
+    int32_t status;
+
+    status = sample(hires->pcf, &previous);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    for (;;) {
+        status = sample(hires->pcf, &current);
+        if (PCF8563_OK != status) {
+            return status;
+        }
+        if (current.seconds != previous.seconds) {
+            break;
+        }
+        if (hires->millis() - start > 2000) {
+            /* Clock is not running. */
+            return PCF8563_ERR_STALE;
+        }
+        previous = current;
+    }
+
+    /* Boundary was crossed between the two latches, take the middle. */
+    hires->phase = (previous.before + (distance(previous.before, current.after) + 1) / 2) % PCF8563_HIRES_RELOAD;
+    hires->anchor = (current.seconds << PCF8563_HIRES_FRACTION) + distance(hires->phase, current.after);
+    hires->anchor_ms = hires->millis();
+    hires->calibrated = 1;
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_hires_read(pcf8563_hires_t *hires, pcf8563_hires_time_t *timestamp)
+{
+    hires_sample_t current;
+    int64_t predicted, periods;
+    uint64_t now;
+    uint8_t offset, ahead;
+    int32_t status;
+
+    if (!hires->calibrated) {
+        return PCF8563_ERR_STALE;
+    }
+
+    for (uint8_t i = 0; ; i++) {
+        status = sample(hires->pcf, &current);
+        if (PCF8563_OK != status) {
+            return status;
+        }
+
+        /* Seconds are consistent unless a boundary fell between the reads. */
+        ahead = distance(current.before, hires->phase);
+        if (0 == ahead || ahead > distance(current.before, current.after)) {
+            break;
+        }
+        if (3 == i) {
+            return PCF8563_ERR_STALE;
+        }
+        hires->retries++;
+    }
+
+    now = hires->millis();
+    if (now - hires->anchor_ms > PCF8563_HIRES_ANCHOR_MS) {
+        hires->calibrated = 0;
+        return PCF8563_ERR_STALE;
+    }
+
+    /*
+     * Timer gives the position within a 1/32 second period. The coarse
+     * clock, counted from the previous timestamp, tells which period.
+     */
+    offset = distance(hires->phase, current.after);
+    predicted = hires->anchor + (int64_t)((now - hires->anchor_ms) * PCF8563_HIRES_HZ / 1000);
+    predicted -= (current.seconds << PCF8563_HIRES_FRACTION) + offset;
+
+    periods = predicted >= 0
+        ? (predicted + PCF8563_HIRES_RELOAD / 2) / PCF8563_HIRES_RELOAD
+        : -((-predicted + PCF8563_HIRES_RELOAD / 2) / PCF8563_HIRES_RELOAD);
+    if (periods < 0) {
+        periods = 0;
+    }
+    if (periods > PCF8563_HIRES_HZ / PCF8563_HIRES_RELOAD - 1) {
+        periods = PCF8563_HIRES_HZ / PCF8563_HIRES_RELOAD - 1;
+    }
+
+    *timestamp = (current.seconds << PCF8563_HIRES_FRACTION) + periods * PCF8563_HIRES_RELOAD + offset;
+    hires->anchor = *timestamp;
+    hires->anchor_ms = now;
+
+    return PCF8563_OK;
+}
@@ -0,0 +1,78 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_HIRES_H
+#define _PCF8563_HIRES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "pcf8563.h"
+
+/* Timer runs from 4096 Hz and wraps 32 times per second. */
+#define PCF8563_HIRES_HZ         (4096)
+#define PCF8563_HIRES_RELOAD     (128)
+#define PCF8563_HIRES_FRACTION   (12)
+/* Coarse clock must not drift 15 ms against the RTC within this time. */
+#define PCF8563_HIRES_ANCHOR_MS  (60000)
+
+/* Q52.12 seconds since 1970-01-01, ie. 1/4096 second resolution. */
+typedef int64_t pcf8563_hires_time_t;
+
+/* Coarse host clock in milliseconds, only used to count timer wraps. */
+typedef uint64_t (* pcf8563_hires_millis_t)(void);
+
+typedef struct {
+    const pcf8563_t *pcf;
+    pcf8563_hires_millis_t millis;
+    /* Timer position at the second boundary. */
+    uint8_t phase;
+    /* Last timestamp and the coarse clock when it was taken. */
+    pcf8563_hires_time_t anchor;
+    uint64_t anchor_ms;
+    uint8_t calibrated;
+    /* Reads repeated because the timer wrapped or a second passed. */
+    uint32_t retries;
+} pcf8563_hires_t;
+
+pcf8563_err_t pcf8563_hires_start(pcf8563_hires_t *hires, const pcf8563_t *pcf, pcf8563_hires_millis_t millis);
+pcf8563_err_t pcf8563_hires_calibrate(pcf8563_hires_t *hires);
+pcf8563_err_t pcf8563_hires_read(pcf8563_hires_t *hires, pcf8563_hires_time_t *timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,154 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "pcf8563.h"
+#include "pcf8563_mux.h"
+
+static int32_t transfer(pcf8563_mux_t *mux, pcf8563_mux_op_t *op)
+{
+    int32_t status;
+
+    status = pcf8563_mux_select(mux, op->channel);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+
+    if (PCF8563_MUX_READ == op->direction) {
+        return mux->hal->read(mux->hal->handle, op->address, op->reg, op->buffer, op->size);
+    }
+    return mux->hal->write(mux->hal->handle, op->address, op->reg, op->buffer, op->size);
+}
+
+pcf8563_err_t pcf8563_mux_init(pcf8563_mux_t *mux, const pcf8563_t *hal, uint8_t address)
+{
+    mux->hal = hal;
+    mux->address = address;
+    mux->selected = PCF8563_MUX_UNKNOWN;
+    mux->selects = 0;
+    mux->skipped = 0;
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_mux_select(pcf8563_mux_t *mux, uint8_t channel)
+{
+    int32_t status;
+
+    if (channel >= PCF8563_MUX_CHANNELS) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    if (channel == mux->selected) {
+        mux->skipped++;
+        return PCF8563_OK;
+    }
+
+    /* Control register is the only byte written to the mux. */
+    mux->selects++;
+    status = mux->hal->write(mux->hal->handle, mux->address, 1 << channel, NULL, 0);
+    mux->selected = PCF8563_OK == status ? channel : PCF8563_MUX_UNKNOWN;
+
+    return status;
+}
+
+void pcf8563_mux_invalidate(pcf8563_mux_t *mux)
+{
+    mux->selected = PCF8563_MUX_UNKNOWN;
+}
+
+pcf8563_err_t pcf8563_mux_batch(pcf8563_mux_t *mux, pcf8563_mux_op_t *ops, uint8_t count)
+{
+    pcf8563_err_t result = PCF8563_OK;
+    uint8_t order[PCF8563_MUX_CHANNELS];
+    uint8_t used = 0;
+
+    /*
+     * Operations on different channels address different devices and can
+     * be reordered. Group them per channel, starting with the channel which
+     * is already selected. Order within a channel is kept.
+     */
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t seen = 0;
+        for (uint8_t j = 0; j < used; j++) {
+            seen |= order[j] == ops[i].channel;
+        }
+        if (seen) {
+            continue;
+        }
+        if (ops[i].channel >= PCF8563_MUX_CHANNELS) {
+            ops[i].status = PCF8563_ERR_INVALID;
+            result = PCF8563_ERR_INVALID;
+            continue;
+        }
+        if (ops[i].channel == mux->selected) {
+            order[used] = order[0];
+            order[0] = ops[i].channel;
+        } else {
+            order[used] = ops[i].channel;
+        }
+        used++;
+    }
+
+    for (uint8_t j = 0; j < used; j++) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (ops[i].channel != order[j]) {
+                continue;
+            }
+            ops[i].status = transfer(mux, &ops[i]);
+            if (PCF8563_OK != ops[i].status && PCF8563_OK == result) {
+                result = ops[i].status;
+            }
+        }
+    }
+
+    return result;
+}
+
+int32_t pcf8563_mux_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    pcf8563_mux_channel_t *channel = handle;
+    pcf8563_mux_op_t op = {channel->channel, PCF8563_MUX_READ, address, reg, buffer, size, 0};
+
+    return transfer(channel->mux, &op);
+}
+
+int32_t pcf8563_mux_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    pcf8563_mux_channel_t *channel = handle;
+    pcf8563_mux_op_t op = {channel->channel, PCF8563_MUX_WRITE, address, reg, (uint8_t *)buffer, size, 0};
+
+    return transfer(channel->mux, &op);
+}
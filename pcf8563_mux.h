@@ -0,0 +1,94 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_MUX_H
+#define _PCF8563_MUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "pcf8563.h"
+
+#define PCF8563_MUX_ADDRESS      (0x70)
+#define PCF8563_MUX_CHANNELS     (0x08)
+/* Selection is not known, next access always selects. */
+#define PCF8563_MUX_UNKNOWN      (0xff)
+
+#define PCF8563_MUX_READ         (0x00)
+#define PCF8563_MUX_WRITE        (0x01)
+
+/*
+ * TCA9548A style mux on the upstream bus. The selected channel is cached
+ * so that consecutive accesses to the same channel skip the select write.
+ */
+typedef struct {
+    const pcf8563_t *hal;
+    uint8_t address;
+    uint8_t selected;
+    /* Number of select writes issued and skipped. */
+    uint32_t selects;
+    uint32_t skipped;
+} pcf8563_mux_t;
+
+/* Handle for pcf8563_mux_i2c_read() and pcf8563_mux_i2c_write(). */
+typedef struct {
+    pcf8563_mux_t *mux;
+    uint8_t channel;
+} pcf8563_mux_channel_t;
+
+typedef struct {
+    uint8_t channel;
+    uint8_t direction;
+    uint8_t address;
+    uint8_t reg;
+    uint8_t *buffer;
+    uint16_t size;
+    int32_t status;
+} pcf8563_mux_op_t;
+
+pcf8563_err_t pcf8563_mux_init(pcf8563_mux_t *mux, const pcf8563_t *hal, uint8_t address);
+pcf8563_err_t pcf8563_mux_select(pcf8563_mux_t *mux, uint8_t channel);
+void pcf8563_mux_invalidate(pcf8563_mux_t *mux);
+pcf8563_err_t pcf8563_mux_batch(pcf8563_mux_t *mux, pcf8563_mux_op_t *ops, uint8_t count);
+
+/* HAL functions for pcf8563_t, handle must point to pcf8563_mux_channel_t. */
+int32_t pcf8563_mux_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t pcf8563_mux_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,154 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcf8563.h"
+#include "pcf8563_retry.h"
+
+typedef struct {
+    uint8_t direction;
+    uint8_t address;
+    uint8_t reg;
+    uint8_t *buffer;
+    uint16_t size;
+} retry_op_t;
+
+static int32_t transfer(pcf8563_retry_t *retry, const retry_op_t *op)
+{
+    const pcf8563_retry_policy_t *policy = &retry->policy;
+    const pcf8563_t *hal = retry->hal;
+    uint64_t start = retry->now();
+    uint32_t delay = policy->base_us;
+    uint8_t class;
+    int32_t status;
+
+    retry->stats.calls++;
+
+    for (uint8_t attempt = 1; ; attempt++) {
+        retry->stats.attempts++;
+        if (op->direction) {
+            status = hal->write(hal->handle, op->address, op->reg, op->buffer, op->size);
+        } else {
+            status = hal->read(hal->handle, op->address, op->reg, op->buffer, op->size);
+        }
+
+        if (PCF8563_OK == status) {
+            retry->stats.successes++;
+            return status;
+        }
+
+        class = retry->classify(status);
+        if (class >= PCF8563_RETRY_CLASSES) {
+            class = PCF8563_RETRY_OTHER;
+        }
+        retry->stats.errors[class]++;
+
+        if (attempt >= policy->attempts || !(policy->retry_on & PCF8563_RETRY_ON(class))) {
+            break;
+        }
+
+        /* Give up early rather than sleep past the budget. */
+        if (policy->budget_us && retry->now() - start + delay > policy->budget_us) {
+            retry->stats.exhausted++;
+            break;
+        }
+
+        retry->sleep(delay);
+        retry->stats.backoff_us += delay;
+
+        delay = delay > policy->max_us / 2 ? policy->max_us : delay * 2;
+    }
+
+    retry->stats.failures++;
+    return status;
+}
+
+pcf8563_err_t pcf8563_retry_init(pcf8563_retry_t *retry, const pcf8563_t *hal, pcf8563_retry_now_t now, pcf8563_retry_sleep_t sleep)
+{
+    memset(retry, 0, sizeof(pcf8563_retry_t));
+
+    if (NULL == now || NULL == sleep) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    retry->hal = hal;
+    retry->now = now;
+    retry->sleep = sleep;
+    retry->classify = &pcf8563_retry_classify_errno;
+    retry->policy.attempts = 4;
+    retry->policy.base_us = 1000;
+    retry->policy.max_us = 8000;
+    retry->policy.budget_us = 20000;
+    retry->policy.retry_on =
+        PCF8563_RETRY_ON(PCF8563_RETRY_NACK) |
+        PCF8563_RETRY_ON(PCF8563_RETRY_TIMEOUT) |
+        PCF8563_RETRY_ON(PCF8563_RETRY_ARBITRATION);
+
+    return PCF8563_OK;
+}
+
+/* See Documentation/i2c/fault-codes in the Linux kernel. */
+uint8_t pcf8563_retry_classify_errno(int32_t status)
+{
+    switch (-status) {
+    case ENXIO:
+#ifdef EREMOTEIO
+    case EREMOTEIO:
+#endif
+        return PCF8563_RETRY_NACK;
+    case ETIMEDOUT:
+        return PCF8563_RETRY_TIMEOUT;
+    case EAGAIN:
+        return PCF8563_RETRY_ARBITRATION;
+    default:
+        return PCF8563_RETRY_OTHER;
+    }
+}
+
+int32_t pcf8563_retry_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    retry_op_t op = {0, address, reg, buffer, size};
+
+    return transfer((pcf8563_retry_t *)handle, &op);
+}
+
+int32_t pcf8563_retry_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    retry_op_t op = {1, address, reg, (uint8_t *)buffer, size};
+
+    return transfer((pcf8563_retry_t *)handle, &op);
+}
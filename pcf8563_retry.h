@@ -0,0 +1,107 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_RETRY_H
+#define _PCF8563_RETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "pcf8563.h"
+
+/* Error classes returned by the classifier. */
+#define PCF8563_RETRY_OTHER         (0x00)
+#define PCF8563_RETRY_NACK          (0x01)
+#define PCF8563_RETRY_TIMEOUT       (0x02)
+#define PCF8563_RETRY_ARBITRATION   (0x03)
+#define PCF8563_RETRY_CLASSES       (0x04)
+
+#define PCF8563_RETRY_ON(class)     (1 << (class))
+
+typedef uint8_t (* pcf8563_retry_classify_t)(int32_t status);
+/* Monotonic time in microseconds and a blocking delay. */
+typedef uint64_t (* pcf8563_retry_now_t)(void);
+typedef void (* pcf8563_retry_sleep_t)(uint32_t us);
+
+typedef struct {
+    /* Maximum number of attempts including the first one. */
+    uint8_t attempts;
+    /* Delay before the first retry, doubled for each retry up to max. */
+    uint32_t base_us;
+    uint32_t max_us;
+    /* Total time one call may take, 0 for no limit. */
+    uint32_t budget_us;
+    /* Mask of PCF8563_RETRY_ON() classes which are retried. */
+    uint8_t retry_on;
+} pcf8563_retry_policy_t;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t attempts;
+    uint64_t successes;
+    uint64_t failures;
+    /* Calls which gave up because the next delay would exceed the budget. */
+    uint64_t exhausted;
+    uint64_t errors[PCF8563_RETRY_CLASSES];
+    uint64_t backoff_us;
+} pcf8563_retry_stats_t;
+
+/*
+ * Retrying wrapper for a HAL. The clock enforces the budget and sleep
+ * provides the backoff delays, both are required.
+ */
+typedef struct {
+    const pcf8563_t *hal;
+    pcf8563_retry_policy_t policy;
+    pcf8563_retry_classify_t classify;
+    pcf8563_retry_now_t now;
+    pcf8563_retry_sleep_t sleep;
+    pcf8563_retry_stats_t stats;
+} pcf8563_retry_t;
+
+pcf8563_err_t pcf8563_retry_init(pcf8563_retry_t *retry, const pcf8563_t *hal, pcf8563_retry_now_t now, pcf8563_retry_sleep_t sleep);
+
+/* Classifier for HALs returning negative errno values such as the Linux i2c-dev one. */
+uint8_t pcf8563_retry_classify_errno(int32_t status);
+
+/* HAL functions for pcf8563_t, handle must point to pcf8563_retry_t. */
+int32_t pcf8563_retry_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t pcf8563_retry_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,224 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "pcf8563.h"
+#include "pcf8563_bus.h"
+
+struct pcf8563_bus_request {
+    pcf8563_bus_request_t *next;
+    pthread_cond_t granted;
+    uint8_t priority;
+    uint8_t done;
+    int64_t enqueued;
+};
+
+static int64_t monotonic(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void account(pcf8563_bus_t *bus, uint8_t priority, int64_t waited)
+{
+    pcf8563_bus_stats_t *stats = &bus->stats[priority];
+
+    stats->transactions++;
+    stats->total_ns += waited;
+    if ((uint64_t)waited > stats->max_ns) {
+        stats->max_ns = waited;
+    }
+}
+
+static void unlink_request(pcf8563_bus_t *bus, pcf8563_bus_request_t *request)
+{
+    pcf8563_bus_request_t **link = &bus->head;
+
+    while (*link != request) {
+        link = &(*link)->next;
+    }
+    *link = request->next;
+    bus->waiting--;
+}
+
+pcf8563_err_t pcf8563_bus_init(pcf8563_bus_t *bus)
+{
+    memset(bus, 0, sizeof(pcf8563_bus_t));
+    bus->aging = PCF8563_BUS_AGING_NS;
+
+    if (0 != pthread_mutex_init(&bus->mutex, NULL)) {
+        return PCF8563_ERR_THREAD;
+    }
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_bus_close(pcf8563_bus_t *bus)
+{
+    pthread_mutex_destroy(&bus->mutex);
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_bus_acquire(pcf8563_bus_t *bus, uint8_t priority, int64_t deadline)
+{
+    pcf8563_bus_request_t request = {0};
+    pthread_condattr_t attr;
+    pcf8563_bus_request_t **tail;
+    struct timespec ts;
+    int64_t start;
+
+    if (priority >= PCF8563_BUS_PRIORITIES) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    pthread_mutex_lock(&bus->mutex);
+    start = monotonic();
+
+    if (!bus->busy && NULL == bus->head) {
+        bus->busy = 1;
+        account(bus, priority, 0);
+        pthread_mutex_unlock(&bus->mutex);
+        return PCF8563_OK;
+    }
+
+    /* Deadlines are in CLOCK_MONOTONIC so the wait must be too. */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (0 != pthread_cond_init(&request.granted, &attr)) {
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_unlock(&bus->mutex);
+        return PCF8563_ERR_THREAD;
+    }
+    pthread_condattr_destroy(&attr);
+
+    request.priority = priority;
+    request.enqueued = start;
+    for (tail = &bus->head; NULL != *tail; tail = &(*tail)->next);
+    *tail = &request;
+    bus->waiting++;
+
+    ts.tv_sec = deadline / 1000000000;
+    ts.tv_nsec = deadline % 1000000000;
+
+    while (!request.done) {
+        if (0 == deadline) {
+            pthread_cond_wait(&request.granted, &bus->mutex);
+        } else if (ETIMEDOUT == pthread_cond_timedwait(&request.granted, &bus->mutex, &ts) && !request.done) {
+            unlink_request(bus, &request);
+            bus->stats[priority].missed++;
+            pthread_mutex_unlock(&bus->mutex);
+            pthread_cond_destroy(&request.granted);
+            return PCF8563_ERR_DEADLINE;
+        }
+    }
+
+    account(bus, priority, monotonic() - start);
+    pthread_mutex_unlock(&bus->mutex);
+    pthread_cond_destroy(&request.granted);
+    return PCF8563_OK;
+}
+
+void pcf8563_bus_release(pcf8563_bus_t *bus)
+{
+    pcf8563_bus_request_t *best = NULL;
+    int64_t key = 0;
+
+    pthread_mutex_lock(&bus->mutex);
+
+    /*
+     * Each class lags the one above it by one aging period. Ordering by
+     * enqueue time plus the lag gives FIFO within a class and promotes
+     * old requests over fresh higher priority ones.
+     */
+    for (pcf8563_bus_request_t *request = bus->head; NULL != request; request = request->next) {
+        int64_t candidate = request->enqueued + request->priority * bus->aging;
+        if (NULL == best || candidate < key) {
+            best = request;
+            key = candidate;
+        }
+    }
+
+    if (NULL == best) {
+        bus->busy = 0;
+    } else {
+        /* Hand the bus over directly, it stays busy. */
+        unlink_request(bus, best);
+        best->done = 1;
+        pthread_cond_signal(&best->granted);
+    }
+
+    pthread_mutex_unlock(&bus->mutex);
+}
+
+void pcf8563_bus_stats(pcf8563_bus_t *bus, uint8_t priority, pcf8563_bus_stats_t *stats)
+{
+    pthread_mutex_lock(&bus->mutex);
+    *stats = bus->stats[priority];
+    pthread_mutex_unlock(&bus->mutex);
+}
+
+int32_t pcf8563_bus_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    pcf8563_bus_client_t *client = handle;
+    int64_t deadline = client->timeout ? monotonic() + client->timeout : 0;
+    int32_t status;
+
+    status = pcf8563_bus_acquire(client->bus, client->priority, deadline);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+    status = client->hal->read(client->hal->handle, address, reg, buffer, size);
+    pcf8563_bus_release(client->bus);
+    return status;
+}
+
+int32_t pcf8563_bus_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    pcf8563_bus_client_t *client = handle;
+    int64_t deadline = client->timeout ? monotonic() + client->timeout : 0;
+    int32_t status;
+
+    status = pcf8563_bus_acquire(client->bus, client->priority, deadline);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+    status = client->hal->write(client->hal->handle, address, reg, buffer, size);
+    pcf8563_bus_release(client->bus);
+    return status;
+}
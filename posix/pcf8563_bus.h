@@ -0,0 +1,109 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_BUS_H
+#define _PCF8563_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "pcf8563.h"
+
+/* Priority classes, lower value is served first. */
+#define PCF8563_BUS_PRIORITY_HIGH    (0)
+#define PCF8563_BUS_PRIORITY_NORMAL  (1)
+#define PCF8563_BUS_PRIORITY_LOW     (2)
+#define PCF8563_BUS_PRIORITIES       (3)
+
+/* Waiting this long promotes a request by one priority class. */
+#define PCF8563_BUS_AGING_NS         (10000000)
+
+typedef struct pcf8563_bus_request pcf8563_bus_request_t;
+
+typedef struct {
+    /* Number of transactions, summed and worst case wait for the bus. */
+    uint64_t transactions;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    /* Requests which gave up because their deadline passed. */
+    uint64_t missed;
+} pcf8563_bus_stats_t;
+
+/*
+ * Arbiter for an I2C bus shared by several drivers. Requests waiting for
+ * the bus are granted in priority order, FIFO within a class. The bus is
+ * handed directly to the chosen waiter on release so that a newcomer can
+ * never jump the queue. A request waiting longer than aging nanoseconds
+ * is promoted by one class per period so that low priority traffic is not
+ * starved.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    uint8_t busy;
+    int64_t aging;
+    pcf8563_bus_request_t *head;
+    uint32_t waiting;
+    pcf8563_bus_stats_t stats[PCF8563_BUS_PRIORITIES];
+} pcf8563_bus_t;
+
+/*
+ * Per driver handle for pcf8563_bus_i2c_read() and pcf8563_bus_i2c_write().
+ * Transactions are forwarded to the wrapped HAL while holding the bus.
+ * Timeout is relative to the start of each transaction, 0 waits forever.
+ */
+typedef struct {
+    pcf8563_bus_t *bus;
+    const pcf8563_t *hal;
+    uint8_t priority;
+    int64_t timeout;
+} pcf8563_bus_client_t;
+
+pcf8563_err_t pcf8563_bus_init(pcf8563_bus_t *bus);
+pcf8563_err_t pcf8563_bus_close(pcf8563_bus_t *bus);
+
+/* Deadline is CLOCK_MONOTONIC nanoseconds, 0 waits forever. */
+pcf8563_err_t pcf8563_bus_acquire(pcf8563_bus_t *bus, uint8_t priority, int64_t deadline);
+void pcf8563_bus_release(pcf8563_bus_t *bus);
+void pcf8563_bus_stats(pcf8563_bus_t *bus, uint8_t priority, pcf8563_bus_stats_t *stats);
+
+int32_t pcf8563_bus_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t pcf8563_bus_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,102 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "pcf8563.h"
+#include "pcf8563_coalesce.h"
+
+pcf8563_err_t pcf8563_coalesce_init(pcf8563_coalesce_t *coalesce, const pcf8563_t *pcf)
+{
+    memset(coalesce, 0, sizeof(pcf8563_coalesce_t));
+    coalesce->pcf = pcf;
+
+    if (0 != pthread_mutex_init(&coalesce->mutex, NULL)) {
+        return PCF8563_ERR_THREAD;
+    }
+    if (0 != pthread_cond_init(&coalesce->done, NULL)) {
+        pthread_mutex_destroy(&coalesce->mutex);
+        return PCF8563_ERR_THREAD;
+    }
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_coalesce_read(pcf8563_coalesce_t *coalesce, struct tm *time)
+{
+    pcf8563_err_t status;
+    uint64_t generation;
+    struct tm result = {0};
+
+    pthread_mutex_lock(&coalesce->mutex);
+    coalesce->requests++;
+
+    if (coalesce->in_flight) {
+        /* Piggyback on the read which is already on the bus. */
+        generation = coalesce->generation;
+        while (generation == coalesce->generation) {
+            pthread_cond_wait(&coalesce->done, &coalesce->mutex);
+        }
+        *time = coalesce->time;
+        status = coalesce->status;
+        pthread_mutex_unlock(&coalesce->mutex);
+        return status;
+    }
+
+    coalesce->in_flight = 1;
+    coalesce->transactions++;
+    pthread_mutex_unlock(&coalesce->mutex);
+
+    /* Bus access happens without holding the lock. */
+    status = pcf8563_read(coalesce->pcf, &result);
+
+    pthread_mutex_lock(&coalesce->mutex);
+    coalesce->time = result;
+    coalesce->status = status;
+    coalesce->in_flight = 0;
+    coalesce->generation++;
+    pthread_cond_broadcast(&coalesce->done);
+    pthread_mutex_unlock(&coalesce->mutex);
+
+    *time = result;
+    return status;
+}
+
+pcf8563_err_t pcf8563_coalesce_close(pcf8563_coalesce_t *coalesce)
+{
+    pthread_cond_destroy(&coalesce->done);
+    pthread_mutex_destroy(&coalesce->mutex);
+    return PCF8563_OK;
+}
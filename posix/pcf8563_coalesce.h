@@ -0,0 +1,72 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_COALESCE_H
+#define _PCF8563_COALESCE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "pcf8563.h"
+
+/*
+ * Thread safe front-end for pcf8563_read(). Callers arriving while a read
+ * is in flight wait for it and share its result instead of issuing their
+ * own bus transaction.
+ */
+typedef struct {
+    const pcf8563_t *pcf;
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+    uint8_t in_flight;
+    uint64_t generation;
+    pcf8563_err_t status;
+    struct tm time;
+    /* Number of bus transactions and number of callers served. */
+    uint64_t transactions;
+    uint64_t requests;
+} pcf8563_coalesce_t;
+
+pcf8563_err_t pcf8563_coalesce_init(pcf8563_coalesce_t *coalesce, const pcf8563_t *pcf);
+pcf8563_err_t pcf8563_coalesce_read(pcf8563_coalesce_t *coalesce, struct tm *time);
+pcf8563_err_t pcf8563_coalesce_close(pcf8563_coalesce_t *coalesce);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
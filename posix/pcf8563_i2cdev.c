@@ -0,0 +1,184 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "pcf8563.h"
+#include "pcf8563_i2cdev.h"
+
+static int system_ioctl(int fd, unsigned long request, void *argument)
+{
+    return ioctl(fd, request, argument);
+}
+
+static int32_t transfer(pcf8563_i2cdev_t *dev, struct i2c_msg *messages, uint32_t count)
+{
+    struct i2c_rdwr_ioctl_data data;
+    pcf8563_i2cdev_ioctl_t call = dev->ioctl ? dev->ioctl : system_ioctl;
+
+    data.msgs = messages;
+    data.nmsgs = count;
+
+    dev->transactions++;
+    if (call(dev->fd, I2C_RDWR, &data) < 0) {
+        return -(errno ? errno : EIO);
+    }
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_i2cdev_open(pcf8563_i2cdev_t *dev, const char *path)
+{
+    dev->ioctl = system_ioctl;
+    dev->transactions = 0;
+    dev->fd = open(path, O_RDWR);
+
+    if (-1 == dev->fd) {
+        return -errno;
+    }
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_i2cdev_close(pcf8563_i2cdev_t *dev)
+{
+    if (-1 != dev->fd && 0 != close(dev->fd)) {
+        return -errno;
+    }
+    dev->fd = -1;
+    return PCF8563_OK;
+}
+
+/*
+ * Register write and data read as one transaction with a repeated start
+ * in between.
+ */
+int32_t pcf8563_i2cdev_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    struct i2c_msg messages[2];
+
+    messages[0].addr = address;
+    messages[0].flags = 0;
+    messages[0].len = 1;
+    messages[0].buf = &reg;
+
+    messages[1].addr = address;
+    messages[1].flags = I2C_M_RD;
+    messages[1].len = size;
+    messages[1].buf = buffer;
+
+    return transfer((pcf8563_i2cdev_t *)handle, messages, 2);
+}
+
+int32_t pcf8563_i2cdev_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    struct i2c_msg message;
+    uint8_t data[PCF8563_I2CDEV_BUFFER_SIZE];
+
+    if (size >= PCF8563_I2CDEV_BUFFER_SIZE) {
+        return -EINVAL;
+    }
+
+    data[0] = reg;
+    memcpy(data + 1, buffer, size);
+
+    message.addr = address;
+    message.flags = 0;
+    message.len = size + 1;
+    message.buf = data;
+
+    return transfer((pcf8563_i2cdev_t *)handle, &message, 1);
+}
+
+/*
+ * Execute several register reads and writes, possibly to different
+ * devices, with a single I2C_RDWR call.
+ */
+pcf8563_err_t pcf8563_i2cdev_batch(pcf8563_i2cdev_t *dev, pcf8563_i2cdev_op_t *ops, uint8_t count)
+{
+    struct i2c_msg messages[PCF8563_I2CDEV_MAX_MESSAGES];
+    uint8_t data[PCF8563_I2CDEV_BUFFER_SIZE];
+    uint32_t used = 0;
+    uint32_t total = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        pcf8563_i2cdev_op_t *op = &ops[i];
+
+        if (PCF8563_I2CDEV_WRITE == op->direction) {
+            if (total + 1 > PCF8563_I2CDEV_MAX_MESSAGES) {
+                return -EINVAL;
+            }
+            if (used + op->size + 1 > PCF8563_I2CDEV_BUFFER_SIZE) {
+                return -EINVAL;
+            }
+
+            data[used] = op->reg;
+            memcpy(data + used + 1, op->buffer, op->size);
+
+            messages[total].addr = op->address;
+            messages[total].flags = 0;
+            messages[total].len = op->size + 1;
+            messages[total].buf = data + used;
+
+            used += op->size + 1;
+            total += 1;
+        } else {
+            if (total + 2 > PCF8563_I2CDEV_MAX_MESSAGES) {
+                return -EINVAL;
+            }
+
+            messages[total].addr = op->address;
+            messages[total].flags = 0;
+            messages[total].len = 1;
+            messages[total].buf = &op->reg;
+
+            messages[total + 1].addr = op->address;
+            messages[total + 1].flags = I2C_M_RD;
+            messages[total + 1].len = op->size;
+            messages[total + 1].buf = op->buffer;
+
+            total += 2;
+        }
+    }
+
+    if (0 == total) {
+        return PCF8563_OK;
+    }
+
+    return transfer(dev, messages, total);
+}
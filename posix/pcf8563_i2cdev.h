@@ -0,0 +1,87 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_I2CDEV_H
+#define _PCF8563_I2CDEV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "pcf8563.h"
+
+/* Linux limits one I2C_RDWR call to 42 messages. */
+#define PCF8563_I2CDEV_MAX_MESSAGES  (42)
+#define PCF8563_I2CDEV_BUFFER_SIZE   (256)
+
+#define PCF8563_I2CDEV_READ          (0x00)
+#define PCF8563_I2CDEV_WRITE         (0x01)
+
+/*
+ * Errors are returned as negative errno values, see Documentation/i2c/
+ * fault-codes in the Linux kernel. Negative values cannot collide with
+ * the PCF8563_ERR_* codes.
+ */
+
+/* Injectable so that tests can run against a fake adapter. */
+typedef int (* pcf8563_i2cdev_ioctl_t)(int fd, unsigned long request, void *argument);
+
+typedef struct {
+    int fd;
+    pcf8563_i2cdev_ioctl_t ioctl;
+    /* Number of I2C_RDWR calls made. */
+    uint32_t transactions;
+} pcf8563_i2cdev_t;
+
+typedef struct {
+    uint8_t direction;
+    uint8_t address;
+    uint8_t reg;
+    uint8_t *buffer;
+    uint16_t size;
+} pcf8563_i2cdev_op_t;
+
+pcf8563_err_t pcf8563_i2cdev_open(pcf8563_i2cdev_t *dev, const char *path);
+pcf8563_err_t pcf8563_i2cdev_close(pcf8563_i2cdev_t *dev);
+pcf8563_err_t pcf8563_i2cdev_batch(pcf8563_i2cdev_t *dev, pcf8563_i2cdev_op_t *ops, uint8_t count);
+
+/* HAL functions for pcf8563_t, handle must point to pcf8563_i2cdev_t. */
+int32_t pcf8563_i2cdev_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t pcf8563_i2cdev_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
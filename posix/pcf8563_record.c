@@ -0,0 +1,386 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pcf8563.h"
+#include "pcf8563_record.h"
+
+static uint64_t monotonic(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint8_t put_varint(uint8_t *buffer, uint64_t value)
+{
+    uint8_t size = 0;
+
+    while (value >= 0x80) {
+        buffer[size++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    buffer[size++] = value;
+    return size;
+}
+
+static uint8_t get_varint(const uint8_t *buffer, size_t available, uint64_t *value)
+{
+    uint8_t size = 0;
+
+    *value = 0;
+    while (size < available && size < 10) {
+        *value |= (uint64_t)(buffer[size] & 0x7f) << (7 * size);
+        if (!(buffer[size++] & 0x80)) {
+            return size;
+        }
+    }
+    return 0;
+}
+
+static void append(pcf8563_record_t *record, uint8_t flags, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size, uint64_t start, int32_t status)
+{
+    /* Flags, address, register and four varints. */
+    uint8_t header[3 + 3 + 10 + 10 + 5];
+    uint8_t length = 0;
+    uint64_t end = record->now();
+
+    if (PCF8563_ADDRESS != address) {
+        flags |= PCF8563_RECORD_ADDRESS;
+    }
+    if (PCF8563_OK != status) {
+        flags |= PCF8563_RECORD_STATUS;
+    }
+    if (0 == record->records) {
+        record->previous_us = start;
+    }
+
+    header[length++] = flags;
+    if (flags & PCF8563_RECORD_ADDRESS) {
+        header[length++] = address;
+    }
+    header[length++] = reg;
+    length += put_varint(header + length, size);
+    length += put_varint(header + length, start - record->previous_us);
+    length += put_varint(header + length, end - start);
+    if (flags & PCF8563_RECORD_STATUS) {
+        /* Zigzag so that small negative values stay short. */
+        length += put_varint(header + length, ((uint32_t)status << 1) ^ (uint32_t)(status >> 31));
+    }
+    /* Nothing is written after a failure so the trace stays parseable. */
+    if (PCF8563_OK != record->error) {
+        return;
+    }
+
+    errno = 0;
+    if (length != fwrite(header, 1, length, record->file)) {
+        record->error = -(errno ? errno : EIO);
+        return;
+    }
+    record->bytes += length;
+
+    if ((flags & PCF8563_RECORD_WRITE) || PCF8563_OK == status) {
+        if (size != fwrite(buffer, 1, size, record->file)) {
+            record->error = -(errno ? errno : EIO);
+            return;
+        }
+        record->bytes += size;
+    }
+
+    record->previous_us = start;
+    record->records++;
+}
+
+pcf8563_err_t pcf8563_record_open(pcf8563_record_t *record, const pcf8563_t *hal, const char *path, pcf8563_record_now_t now)
+{
+    uint8_t header[PCF8563_RECORD_HEADER_SIZE] = {
+        PCF8563_RECORD_MAGIC & 0xff, (PCF8563_RECORD_MAGIC >> 8) & 0xff,
+        (PCF8563_RECORD_MAGIC >> 16) & 0xff, (PCF8563_RECORD_MAGIC >> 24) & 0xff,
+        PCF8563_RECORD_VERSION
+    };
+
+    memset(record, 0, sizeof(pcf8563_record_t));
+    record->hal = hal;
+    record->now = now ? now : monotonic;
+
+    record->file = fopen(path, "wb");
+    if (NULL == record->file) {
+        return -errno;
+    }
+    if (sizeof(header) != fwrite(header, 1, sizeof(header), record->file)) {
+        fclose(record->file);
+        record->file = NULL;
+        return -errno;
+    }
+    record->bytes = sizeof(header);
+
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_record_close(pcf8563_record_t *record)
+{
+    /* Buffered data is written only now, so the disk can fill up here too. */
+    errno = 0;
+    if (NULL != record->file && 0 != fclose(record->file) && PCF8563_OK == record->error) {
+        record->error = -(errno ? errno : EIO);
+    }
+    record->file = NULL;
+    return record->error;
+}
+
+int32_t pcf8563_record_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    pcf8563_record_t *record = handle;
+    uint64_t start = record->now();
+    int32_t status;
+
+    status = record->hal->read(record->hal->handle, address, reg, buffer, size);
+    append(record, 0, address, reg, buffer, size, start, status);
+
+    return status;
+}
+
+int32_t pcf8563_record_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    pcf8563_record_t *record = handle;
+    uint64_t start = record->now();
+    int32_t status;
+
+    status = record->hal->write(record->hal->handle, address, reg, buffer, size);
+    append(record, PCF8563_RECORD_WRITE, address, reg, buffer, size, start, status);
+
+    return status;
+}
+
+/* Parses the record at offset, returns the offset of the next one or 0. */
+static size_t parse(const pcf8563_replay_t *replay, size_t offset, pcf8563_replay_record_t *record)
+{
+    const uint8_t *data = replay->data;
+    size_t size = replay->size;
+    uint64_t value;
+    uint8_t length;
+
+    if (offset + 2 > size) {
+        return 0;
+    }
+
+    record->flags = data[offset++];
+    record->address = PCF8563_ADDRESS;
+    if (record->flags & PCF8563_RECORD_ADDRESS) {
+        record->address = data[offset++];
+    }
+    if (offset >= size) {
+        return 0;
+    }
+    record->reg = data[offset++];
+
+    if (!(length = get_varint(data + offset, size - offset, &value)) || value > UINT16_MAX) {
+        return 0;
+    }
+    record->size = value;
+    offset += length;
+
+    if (!(length = get_varint(data + offset, size - offset, &value))) {
+        return 0;
+    }
+    record->start_us = replay->start_us + value;
+    offset += length;
+
+    if (!(length = get_varint(data + offset, size - offset, &value))) {
+        return 0;
+    }
+    record->duration_us = value;
+    offset += length;
+
+    record->status = PCF8563_OK;
+    if (record->flags & PCF8563_RECORD_STATUS) {
+        if (!(length = get_varint(data + offset, size - offset, &value))) {
+            return 0;
+        }
+        record->status = (int32_t)((uint32_t)value >> 1) ^ -(int32_t)(value & 1);
+        offset += length;
+    }
+
+    record->data = NULL;
+    if ((record->flags & PCF8563_RECORD_WRITE) || PCF8563_OK == record->status) {
+        if (offset + record->size > size) {
+            return 0;
+        }
+        record->data = data + offset;
+        offset += record->size;
+    }
+
+    return offset;
+}
+
+pcf8563_err_t pcf8563_replay_open(pcf8563_replay_t *replay, const char *path)
+{
+    FILE *file;
+    long size;
+
+    memset(replay, 0, sizeof(pcf8563_replay_t));
+
+    file = fopen(path, "rb");
+    if (NULL == file) {
+        return -errno;
+    }
+
+    if (0 != fseek(file, 0, SEEK_END) || (size = ftell(file)) < 0 || 0 != fseek(file, 0, SEEK_SET)) {
+        fclose(file);
+        return -errno;
+    }
+
+    replay->data = malloc(size ? size : 1);
+    if (NULL == replay->data) {
+        fclose(file);
+        return -ENOMEM;
+    }
+    replay->size = fread(replay->data, 1, size, file);
+    fclose(file);
+
+    if (
+        replay->size < PCF8563_RECORD_HEADER_SIZE ||
+        PCF8563_RECORD_MAGIC != (replay->data[0] | replay->data[1] << 8 | replay->data[2] << 16 | (uint32_t)replay->data[3] << 24) ||
+        PCF8563_RECORD_VERSION != replay->data[4]
+    ) {
+        pcf8563_replay_close(replay);
+        return PCF8563_ERR_INVALID;
+    }
+
+    pcf8563_replay_rewind(replay);
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_replay_close(pcf8563_replay_t *replay)
+{
+    free(replay->data);
+    replay->data = NULL;
+    replay->size = 0;
+    return PCF8563_OK;
+}
+
+void pcf8563_replay_rewind(pcf8563_replay_t *replay)
+{
+    replay->offset = PCF8563_RECORD_HEADER_SIZE;
+    replay->start_us = 0;
+    replay->now_us = 0;
+}
+
+pcf8563_err_t pcf8563_replay_peek(const pcf8563_replay_t *replay, pcf8563_replay_record_t *record)
+{
+    if (replay->offset >= replay->size) {
+        return PCF8563_ERR_REPLAY_END;
+    }
+    if (0 == parse(replay, replay->offset, record)) {
+        return PCF8563_ERR_INVALID;
+    }
+    return PCF8563_OK;
+}
+
+pcf8563_err_t pcf8563_replay_next(pcf8563_replay_t *replay, pcf8563_replay_record_t *record)
+{
+    pcf8563_err_t status = pcf8563_replay_peek(replay, record);
+
+    if (PCF8563_OK == status) {
+        replay->offset = parse(replay, replay->offset, record);
+        replay->start_us = record->start_us;
+        replay->now_us = record->start_us + record->duration_us;
+        replay->records++;
+    }
+    return status;
+}
+
+/*
+ * Transaction which does not match the recording is not consumed, so the
+ * caller can tell where the code under test went a different way.
+ */
+static int32_t expect(pcf8563_replay_t *replay, uint8_t flags, uint8_t address, uint8_t reg, uint16_t size, pcf8563_replay_record_t *record)
+{
+    pcf8563_err_t status = pcf8563_replay_peek(replay, record);
+
+    if (PCF8563_OK != status) {
+        return status;
+    }
+    if (
+        (record->flags & PCF8563_RECORD_WRITE) != flags ||
+        record->address != address || record->reg != reg || record->size != size
+    ) {
+        replay->mismatches++;
+        return PCF8563_ERR_REPLAY_MISMATCH;
+    }
+    return PCF8563_OK;
+}
+
+int32_t pcf8563_replay_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    pcf8563_replay_t *replay = handle;
+    pcf8563_replay_record_t record;
+    int32_t status;
+
+    status = expect(replay, 0, address, reg, size, &record);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+    if (record.data) {
+        memcpy(buffer, record.data, size);
+    }
+    pcf8563_replay_next(replay, &record);
+
+    return record.status;
+}
+
+int32_t pcf8563_replay_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    pcf8563_replay_t *replay = handle;
+    pcf8563_replay_record_t record;
+    int32_t status;
+
+    status = expect(replay, PCF8563_RECORD_WRITE, address, reg, size, &record);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+    if (size && 0 != memcmp(buffer, record.data, size)) {
+        replay->mismatches++;
+        return PCF8563_ERR_REPLAY_MISMATCH;
+    }
+    pcf8563_replay_next(replay, &record);
+
+    return record.status;
+}
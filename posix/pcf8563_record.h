@@ -0,0 +1,141 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_RECORD_H
+#define _PCF8563_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pcf8563.h"
+
+#define PCF8563_RECORD_MAGIC         (0x52464350)
+#define PCF8563_RECORD_VERSION       (0x01)
+#define PCF8563_RECORD_HEADER_SIZE   (0x05)
+
+/* Record flags, see the file format below. */
+#define PCF8563_RECORD_WRITE         (0b00000001)
+#define PCF8563_RECORD_STATUS        (0b00000010)
+#define PCF8563_RECORD_ADDRESS       (0b00000100)
+
+/*
+ * File starts with the magic and version. Each transaction is then
+ *
+ *   flags            1 byte
+ *   address          1 byte, only if not PCF8563_ADDRESS
+ *   register         1 byte
+ *   size             varint
+ *   gap              varint, microseconds since the previous start
+ *   duration         varint, microseconds
+ *   status           zigzag varint, only if not PCF8563_OK
+ *   data             size bytes, missing for failed reads
+ *
+ * Varints are little endian base 128. Reading the time once a second
+ * takes 15 bytes.
+ */
+
+/* Monotonic host time in microseconds. */
+typedef uint64_t (* pcf8563_record_now_t)(void);
+
+typedef struct {
+    const pcf8563_t *hal;
+    FILE *file;
+    pcf8563_record_now_t now;
+    uint64_t previous_us;
+    /* First error writing the file as negative errno, recording stops. */
+    int32_t error;
+    /* Number of transactions and bytes written. */
+    uint32_t records;
+    uint64_t bytes;
+} pcf8563_record_t;
+
+typedef struct {
+    uint8_t flags;
+    uint8_t address;
+    uint8_t reg;
+    uint16_t size;
+    int32_t status;
+    /* Microseconds since the first transaction. */
+    uint64_t start_us;
+    uint32_t duration_us;
+    const uint8_t *data;
+} pcf8563_replay_record_t;
+
+/*
+ * The whole recording is kept in memory so replay does not do any I/O.
+ * Time stands still between transactions, now_us is the recorded end of
+ * the latest one and can drive timeouts and clocks in the code under test.
+ */
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t offset;
+    uint64_t start_us;
+    uint64_t now_us;
+    /* Number of transactions replayed and not matching the recording. */
+    uint32_t records;
+    uint32_t mismatches;
+} pcf8563_replay_t;
+
+/*
+ * When now is NULL CLOCK_MONOTONIC is used. Errors are negative errno
+ * values like in the i2c-dev HAL. The HAL functions always return the
+ * status of the bus. If the file cannot be written recording stops and
+ * the error is kept in error and returned by pcf8563_record_close().
+ */
+pcf8563_err_t pcf8563_record_open(pcf8563_record_t *record, const pcf8563_t *hal, const char *path, pcf8563_record_now_t now);
+pcf8563_err_t pcf8563_record_close(pcf8563_record_t *record);
+
+/* HAL functions for pcf8563_t, handle must point to pcf8563_record_t. */
+int32_t pcf8563_record_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t pcf8563_record_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+pcf8563_err_t pcf8563_replay_open(pcf8563_replay_t *replay, const char *path);
+pcf8563_err_t pcf8563_replay_close(pcf8563_replay_t *replay);
+void pcf8563_replay_rewind(pcf8563_replay_t *replay);
+pcf8563_err_t pcf8563_replay_peek(const pcf8563_replay_t *replay, pcf8563_replay_record_t *record);
+pcf8563_err_t pcf8563_replay_next(pcf8563_replay_t *replay, pcf8563_replay_record_t *record);
+
+/* HAL functions for pcf8563_t, handle must point to pcf8563_replay_t. */
+int32_t pcf8563_replay_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t pcf8563_replay_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,171 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pcf8563.h"
+#include "pcf8563_shm.h"
+
+pcf8563_shm_page_t *pcf8563_shm_create(const char *name)
+{
+    pcf8563_shm_page_t *page;
+    int fd;
+
+    fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (-1 == fd) {
+        return NULL;
+    }
+
+    if (-1 == ftruncate(fd, sizeof(pcf8563_shm_page_t))) {
+        close(fd);
+        return NULL;
+    }
+
+    page = mmap(
+        NULL, sizeof(pcf8563_shm_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0
+    );
+    close(fd);
+
+    if (MAP_FAILED == page) {
+        return NULL;
+    }
+
+    pcf8563_shm_init(page);
+    return page;
+}
+
+const pcf8563_shm_page_t *pcf8563_shm_open(const char *name)
+{
+    const pcf8563_shm_page_t *page;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (-1 == fd) {
+        return NULL;
+    }
+
+    page = mmap(
+        NULL, sizeof(pcf8563_shm_page_t), PROT_READ, MAP_SHARED, fd, 0
+    );
+    close(fd);
+
+    if (MAP_FAILED == page) {
+        return NULL;
+    }
+
+    return page;
+}
+
+void pcf8563_shm_close(const pcf8563_shm_page_t *page)
+{
+    munmap((void *)page, sizeof(pcf8563_shm_page_t));
+}
+
+void pcf8563_shm_unlink(const char *name)
+{
+    shm_unlink(name);
+}
+
+void pcf8563_shm_init(pcf8563_shm_page_t *page)
+{
+    atomic_store_explicit(&page->sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    page->status = PCF8563_ERR_NO_DATA;
+    page->epoch = 0;
+    page->updated = 0;
+    page->version = PCF8563_SHM_VERSION;
+    page->magic = PCF8563_SHM_MAGIC;
+
+    /* Even sequence, but nothing has been published yet. */
+    atomic_store_explicit(&page->sequence, 2, memory_order_release);
+}
+
+void pcf8563_shm_publish(pcf8563_shm_page_t *page, pcf8563_err_t status, int64_t epoch, int64_t updated)
+{
+    uint32_t sequence;
+
+    sequence = atomic_load_explicit(&page->sequence, memory_order_relaxed);
+
+    /* Odd sequence tells readers an update is in progress. */
+    atomic_store_explicit(&page->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    page->status = status;
+    page->epoch = epoch;
+    page->updated = updated;
+
+    atomic_store_explicit(&page->sequence, sequence + 2, memory_order_release);
+}
+
+pcf8563_err_t pcf8563_shm_read(const pcf8563_shm_page_t *page, pcf8563_shm_sample_t *sample)
+{
+    uint32_t begin, end;
+    time_t epoch;
+
+    if (PCF8563_SHM_MAGIC != page->magic || PCF8563_SHM_VERSION != page->version) {
+        return PCF8563_ERR_NO_DATA;
+    }
+
+    do {
+        begin = atomic_load_explicit(
+            (atomic_uint *)&page->sequence, memory_order_acquire
+        );
+        if (begin & 1) {
+            continue;
+        }
+
+        sample->status = page->status;
+        sample->epoch = page->epoch;
+        sample->updated = page->updated;
+
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(
+            (atomic_uint *)&page->sequence, memory_order_relaxed
+        );
+    } while ((begin & 1) || begin != end);
+
+    sample->sequence = begin;
+
+    /* Done outside the loop so retries stay cheap. */
+    epoch = (time_t)sample->epoch;
+    gmtime_r(&epoch, &sample->time);
+
+    return sample->status;
+}
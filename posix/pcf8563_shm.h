@@ -0,0 +1,87 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_SHM_H
+#define _PCF8563_SHM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "pcf8563.h"
+
+#define PCF8563_SHM_NAME         "/pcf8563"
+#define PCF8563_SHM_MAGIC        (0x50434638)
+#define PCF8563_SHM_VERSION      (0x01)
+
+/*
+ * Time page shared between the daemon and the clients. The daemon is the
+ * only writer. Sequence is odd while an update is in progress.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    atomic_uint sequence;
+    int32_t status;
+    int64_t epoch;
+    int64_t updated;
+} pcf8563_shm_page_t;
+
+typedef struct {
+    pcf8563_err_t status;
+    /* RTC date and time, RTC is assumed to be in UTC. */
+    struct tm time;
+    /* Seconds since 1970-01-01 UTC. */
+    int64_t epoch;
+    /* CLOCK_MONOTONIC nanoseconds when the RTC was read. */
+    int64_t updated;
+    uint32_t sequence;
+} pcf8563_shm_sample_t;
+
+pcf8563_shm_page_t *pcf8563_shm_create(const char *name);
+const pcf8563_shm_page_t *pcf8563_shm_open(const char *name);
+void pcf8563_shm_close(const pcf8563_shm_page_t *page);
+void pcf8563_shm_unlink(const char *name);
+
+void pcf8563_shm_init(pcf8563_shm_page_t *page);
+void pcf8563_shm_publish(pcf8563_shm_page_t *page, pcf8563_err_t status, int64_t epoch, int64_t updated);
+pcf8563_err_t pcf8563_shm_read(const pcf8563_shm_page_t *page, pcf8563_shm_sample_t *sample);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
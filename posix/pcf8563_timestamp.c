@@ -0,0 +1,263 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcf8563.h"
+#include "pcf8563_timestamp.h"
+
+typedef struct {
+    const pcf8563_timestamp_t *owner;
+    uint32_t sequence;
+    uint64_t base;
+    int64_t base_ns;
+    uint64_t mult;
+    uint64_t end;
+    int64_t end_ns;
+    uint64_t rate;
+    int64_t last;
+} timestamp_cache_t;
+
+static _Thread_local timestamp_cache_t cache;
+
+/* delta * mult >> 32 without a 128 bit type. */
+static uint64_t scale(uint64_t delta, uint64_t mult)
+{
+    uint64_t lo = (delta & 0xffffffff) * (mult & 0xffffffff);
+    uint64_t mid1 = (delta >> 32) * (mult & 0xffffffff);
+    uint64_t mid2 = (delta & 0xffffffff) * (mult >> 32);
+    uint64_t hi = (delta >> 32) * (mult >> 32);
+
+    return (hi << 32) + mid1 + mid2 + (lo >> 32);
+}
+
+/* (value << 32) / divisor by long division. */
+static uint64_t divide(uint64_t value, uint64_t divisor)
+{
+    uint64_t quotient = value / divisor;
+    uint64_t remainder = value % divisor;
+
+    for (uint8_t i = 0; i < 32; i++) {
+        quotient <<= 1;
+        if (remainder >= divisor - remainder) {
+            remainder -= divisor - remainder;
+            quotient |= 1;
+        } else {
+            remainder <<= 1;
+        }
+    }
+    return quotient;
+}
+
+static int64_t map(const timestamp_cache_t *mapping, uint64_t counter)
+{
+    if (counter < mapping->base) {
+        return mapping->base_ns;
+    }
+    if (counter < mapping->end) {
+        return mapping->base_ns + scale(counter - mapping->base, mapping->mult);
+    }
+    return mapping->end_ns + scale(counter - mapping->end, mapping->rate);
+}
+
+static void load(const pcf8563_timestamp_t *timestamp, timestamp_cache_t *mapping)
+{
+    mapping->base = timestamp->base;
+    mapping->base_ns = timestamp->base_ns;
+    mapping->mult = timestamp->mult;
+    mapping->end = timestamp->end;
+    mapping->end_ns = timestamp->end_ns;
+    mapping->rate = timestamp->rate;
+}
+
+pcf8563_err_t pcf8563_timestamp_init(
+    pcf8563_timestamp_t *timestamp, const pcf8563_t *pcf,
+    pcf8563_timestamp_counter_t counter, uint64_t hz
+)
+{
+    memset(timestamp, 0, sizeof(pcf8563_timestamp_t));
+
+    if (0 == hz) {
+        return PCF8563_ERR_INVALID;
+    }
+
+    timestamp->pcf = pcf;
+    timestamp->counter = counter;
+    timestamp->rate = divide(1000000000, hz);
+    timestamp->mult = timestamp->rate;
+
+    /* Counts nanoseconds from zero until the first edge. */
+    timestamp->base = counter();
+    timestamp->end = timestamp->base;
+    atomic_init(&timestamp->sequence, 0);
+
+    return PCF8563_OK;
+}
+
+/*
+ * Poll the RTC until the seconds change and feed the edge. Edge is taken
+ * to be halfway between the last two reads. Blocks up to one second.
+ */
+pcf8563_err_t pcf8563_timestamp_sync(pcf8563_timestamp_t *timestamp)
+{
+    uint8_t raw[PCF8563_TIME_SIZE];
+    uint64_t previous, current;
+    uint8_t seconds;
+    int32_t status;
+
+    status = pcf8563_read_raw(timestamp->pcf, raw);
+    if (PCF8563_OK != status) {
+        return status;
+    }
+    seconds = raw[0] & 0b01111111;
+    current = timestamp->counter();
+
+    for (uint32_t i = 0; ; i++) {
+        previous = current;
+        status = pcf8563_read_raw(timestamp->pcf, raw);
+        if (PCF8563_OK != status) {
+            return status;
+        }
+        current = timestamp->counter();
+        if ((raw[0] & 0b01111111) != seconds) {
+            break;
+        }
+        if (100000 == i) {
+            return PCF8563_ERR_STALE;
+        }
+    }
+
+    pcf8563_timestamp_edge(
+        timestamp,
+        pcf8563_datetime_to_epoch(pcf8563_raw_to_datetime(raw)),
+        previous + (current - previous) / 2
+    );
+    return PCF8563_OK;
+}
+
+/* Feed an RTC second edge, for example from an interrupt. Single writer. */
+void pcf8563_timestamp_edge(pcf8563_timestamp_t *timestamp, int64_t seconds, uint64_t counter)
+{
+    timestamp_cache_t mapping;
+    uint32_t sequence;
+    int64_t target, now, error;
+    uint64_t slewed, duration;
+
+    load(timestamp, &mapping);
+    target = seconds * 1000000000;
+
+    /* Counter rate measured since the first edge, jitter averages out. */
+    if (!timestamp->synced) {
+        timestamp->origin = counter;
+        timestamp->origin_seconds = seconds;
+    } else if (seconds > timestamp->origin_seconds && counter > timestamp->origin) {
+        timestamp->rate = divide(
+            (seconds - timestamp->origin_seconds) * 1000000000, counter - timestamp->origin
+        );
+    }
+    error = target - map(&mapping, counter);
+    timestamp->offset_ns = error;
+    timestamp->syncs++;
+
+    sequence = atomic_load_explicit(&timestamp->sequence, memory_order_relaxed);
+    atomic_store_explicit(&timestamp->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    /*
+     * Anchor where readers of the old mapping stopped so time continues
+     * without a jump. Only forward steps are allowed.
+     */
+    counter = timestamp->counter();
+    now = map(&mapping, counter);
+
+    timestamp->base = counter;
+    timestamp->base_ns = now;
+
+    if (!timestamp->synced || error > PCF8563_TIMESTAMP_STEP_NS) {
+        timestamp->base_ns = now + error;
+        timestamp->mult = timestamp->rate;
+        timestamp->end = counter;
+        timestamp->end_ns = timestamp->base_ns;
+        timestamp->synced = 1;
+        timestamp->steps++;
+    } else {
+        /* Run fast or slow until the error is gone. */
+        slewed = timestamp->rate / 1000000 * PCF8563_TIMESTAMP_SLEW_PPM;
+        duration = (error < 0 ? -error : error) * (1000000 / PCF8563_TIMESTAMP_SLEW_PPM);
+
+        timestamp->mult = error < 0 ? timestamp->rate - slewed : timestamp->rate + slewed;
+        timestamp->end = counter + divide(duration, timestamp->rate);
+        timestamp->end_ns = now + scale(timestamp->end - counter, timestamp->mult);
+    }
+
+    atomic_store_explicit(&timestamp->sequence, sequence + 2, memory_order_release);
+}
+
+int64_t pcf8563_timestamp_now(pcf8563_timestamp_t *timestamp)
+{
+    uint32_t begin, end;
+    int64_t now;
+
+    begin = atomic_load_explicit(&timestamp->sequence, memory_order_acquire);
+
+    /* Shared state is only read when the mapping has changed. */
+    if (cache.owner != timestamp || cache.sequence != begin) {
+        do {
+            begin = atomic_load_explicit(&timestamp->sequence, memory_order_acquire);
+            if (begin & 1) {
+                continue;
+            }
+            load(timestamp, &cache);
+            atomic_thread_fence(memory_order_acquire);
+            end = atomic_load_explicit(&timestamp->sequence, memory_order_relaxed);
+        } while ((begin & 1) || begin != end);
+
+        if (cache.owner != timestamp) {
+            cache.owner = timestamp;
+            cache.last = INT64_MIN;
+        }
+        cache.sequence = begin;
+    }
+
+    now = map(&cache, timestamp->counter());
+
+    /* Strictly increasing within a thread. */
+    if (now <= cache.last) {
+        now = cache.last + 1;
+    }
+    cache.last = now;
+
+    return now;
+}
@@ -0,0 +1,91 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _PCF8563_TIMESTAMP_H
+#define _PCF8563_TIMESTAMP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "pcf8563.h"
+
+/* Errors larger than this forward are stepped, everything else slewed. */
+#define PCF8563_TIMESTAMP_STEP_NS    (100000000)
+/* Maximum slew rate in parts per million. */
+#define PCF8563_TIMESTAMP_SLEW_PPM   (500)
+
+/* Free running high resolution counter such as TSC or a cycle counter. */
+typedef uint64_t (* pcf8563_timestamp_counter_t)(void);
+
+/*
+ * Maps counter values to nanoseconds since 1970-01-01 anchored on RTC
+ * second edges. Until end the mapping runs at the slewed mult, after that
+ * at the measured rate. Multipliers are nanoseconds per count in 32.32
+ * fixed point. Readers cache the mapping per thread and only reload it
+ * when the sequence changes.
+ */
+typedef struct {
+    const pcf8563_t *pcf;
+    pcf8563_timestamp_counter_t counter;
+
+    atomic_uint sequence;
+    uint64_t base;
+    int64_t base_ns;
+    uint64_t mult;
+    uint64_t end;
+    int64_t end_ns;
+    uint64_t rate;
+
+    /* Writer only, first edge seen. */
+    uint64_t origin;
+    int64_t origin_seconds;
+    uint8_t synced;
+    /* Last measured error, RTC minus mapping. */
+    int64_t offset_ns;
+    uint32_t syncs;
+    uint32_t steps;
+} pcf8563_timestamp_t;
+
+pcf8563_err_t pcf8563_timestamp_init(pcf8563_timestamp_t *timestamp, const pcf8563_t *pcf, pcf8563_timestamp_counter_t counter, uint64_t hz);
+pcf8563_err_t pcf8563_timestamp_sync(pcf8563_timestamp_t *timestamp);
+void pcf8563_timestamp_edge(pcf8563_timestamp_t *timestamp, int64_t seconds, uint64_t counter);
+int64_t pcf8563_timestamp_now(pcf8563_timestamp_t *timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,174 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+/*
+ * Polls the RTC and publishes the time into a shared memory page. Clients
+ * read the page with pcf8563_shm_read() without touching the I2C bus.
+ *
+ * Usage: pcf8563d [-d /dev/i2c-1] [-n /pcf8563] [-i 100] [-r trace.bin]
+ *
+ * With -r all bus transactions are recorded for pcf8563_replay_open().
+ */
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pcf8563.h"
+#include "pcf8563_i2cdev.h"
+#include "pcf8563_record.h"
+#include "pcf8563_shm.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int signal)
+{
+    running = 0;
+}
+
+static int64_t monotonic(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    const char *device = "/dev/i2c-1";
+    const char *name = PCF8563_SHM_NAME;
+    const char *trace = NULL;
+    long interval = 100;
+    pcf8563_shm_page_t *page;
+    pcf8563_err_t status;
+    struct timespec delay;
+    pcf8563_datetime_t datetime;
+    int64_t epoch = 0;
+    int64_t updated = 0;
+    pcf8563_i2cdev_t dev;
+    pcf8563_record_t record;
+    pcf8563_t hal;
+    pcf8563_t pcf;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "d:n:i:r:"))) {
+        switch (opt) {
+        case 'd':
+            device = optarg;
+            break;
+        case 'n':
+            name = optarg;
+            break;
+        case 'i':
+            interval = strtol(optarg, NULL, 10);
+            break;
+        case 'r':
+            trace = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-d device] [-n name] [-i interval_ms] [-r trace]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (interval <= 0) {
+        interval = 100;
+    }
+
+    if (PCF8563_OK != pcf8563_i2cdev_open(&dev, device)) {
+        perror(device);
+        return EXIT_FAILURE;
+    }
+
+    page = pcf8563_shm_create(name);
+    if (NULL == page) {
+        perror(name);
+        pcf8563_i2cdev_close(&dev);
+        return EXIT_FAILURE;
+    }
+
+    hal.read = &pcf8563_i2cdev_read;
+    hal.write = &pcf8563_i2cdev_write;
+    hal.handle = &dev;
+    pcf = hal;
+
+    if (trace) {
+        if (PCF8563_OK != pcf8563_record_open(&record, &hal, trace, NULL)) {
+            perror(trace);
+            pcf8563_shm_close(page);
+            pcf8563_shm_unlink(name);
+            pcf8563_i2cdev_close(&dev);
+            return EXIT_FAILURE;
+        }
+        pcf.read = &pcf8563_record_i2c_read;
+        pcf.write = &pcf8563_record_i2c_write;
+        pcf.handle = &record;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    delay.tv_sec = interval / 1000;
+    delay.tv_nsec = (interval % 1000) * 1000000;
+
+    while (running) {
+        status = pcf8563_read_datetime(&pcf, &datetime);
+
+        /*
+         * With low voltage the registers were read fine and clients get the
+         * time along with the warning. On failure they get the status with
+         * the last good time.
+         */
+        if (PCF8563_OK == status || PCF8563_ERR_LOW_VOLTAGE == status) {
+            /* RTC is assumed to be in UTC. */
+            epoch = pcf8563_datetime_to_epoch(datetime);
+            updated = monotonic();
+        }
+        pcf8563_shm_publish(page, status, epoch, updated);
+        nanosleep(&delay, NULL);
+    }
+
+    pcf8563_close(&pcf);
+    if (trace) {
+        pcf8563_record_close(&record);
+    }
+    pcf8563_shm_close(page);
+    pcf8563_shm_unlink(name);
+    pcf8563_i2cdev_close(&dev);
+
+    return EXIT_SUCCESS;
+}
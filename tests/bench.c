@@ -0,0 +1,341 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "pcf8563.h"
+#include "pcf8563_coalesce.h"
+#include "pcf8563_timestamp.h"
+#include "pcf8563_record.h"
+#include "mock_i2c.h"
+
+#define BENCH_SECONDS  (0.5)
+#define BENCH_MAX_THREADS  (32)
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static pcf8563_coalesce_t coalesce;
+static volatile int running;
+
+static void *coalesce_reader(void *arg)
+{
+    struct tm datetime;
+
+    while (running) {
+        pcf8563_coalesce_read(&coalesce, &datetime);
+    }
+    return NULL;
+}
+
+static void bench_coalesce(void)
+{
+    pthread_t threads[BENCH_MAX_THREADS];
+    struct timespec delay = {0, BENCH_SECONDS * 1e9};
+    double start, elapsed;
+    pcf8563_t pcf;
+
+    pcf.read = &mock_slow_i2c_read;
+    pcf.write = &mock_i2c_write;
+    pcf.handle = NULL;
+
+    printf("pcf8563_coalesce_read(), %u us per bus transaction\n", mock_i2c_delay_us);
+    printf("%8s %16s %16s\n", "threads", "transactions/s", "reads/s");
+
+    for (uint16_t count = 1; count <= BENCH_MAX_THREADS; count *= 2) {
+        pcf8563_coalesce_init(&coalesce, &pcf);
+        running = 1;
+        start = now();
+
+        for (uint16_t i = 0; i < count; i++) {
+            pthread_create(&threads[i], NULL, coalesce_reader, NULL);
+        }
+        nanosleep(&delay, NULL);
+        running = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        elapsed = now() - start;
+        printf(
+            "%8u %16.0f %16.0f\n", count,
+            coalesce.transactions / elapsed, coalesce.requests / elapsed
+        );
+        pcf8563_coalesce_close(&coalesce);
+    }
+    printf("\n");
+}
+
+#define BENCH_FORMAT_COUNT  (1024)
+#define BENCH_FORMAT_ROUNDS  (1000)
+
+static void bench_format(void)
+{
+    static uint8_t raw[BENCH_FORMAT_COUNT * PCF8563_TIME_SIZE];
+    static char buffer[BENCH_FORMAT_COUNT * PCF8563_ISO8601_SIZE];
+    struct tm datetime;
+    double start, elapsed;
+    uint32_t total = BENCH_FORMAT_COUNT * BENCH_FORMAT_ROUNDS;
+
+    for (uint32_t i = 0; i < BENCH_FORMAT_COUNT; i++) {
+        pcf8563_datetime_to_tm(pcf8563_datetime_from_epoch(1167002120 + i * 7919), &datetime);
+        pcf8563_tm_to_raw(&datetime, raw + i * PCF8563_TIME_SIZE);
+    }
+
+    printf("ISO-8601 formatting, %u timestamps\n", total);
+
+    start = now();
+    for (uint32_t round = 0; round < BENCH_FORMAT_ROUNDS; round++) {
+        pcf8563_format_iso8601_batch(raw, buffer, BENCH_FORMAT_COUNT);
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "pcf8563_format_iso8601_batch()", elapsed * 1e9 / total);
+
+    start = now();
+    for (uint32_t round = 0; round < BENCH_FORMAT_ROUNDS; round++) {
+        for (uint32_t i = 0; i < BENCH_FORMAT_COUNT; i++) {
+            pcf8563_format_iso8601(raw + i * PCF8563_TIME_SIZE, buffer + i * PCF8563_ISO8601_SIZE);
+        }
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "pcf8563_format_iso8601()", elapsed * 1e9 / total);
+
+    start = now();
+    for (uint32_t round = 0; round < BENCH_FORMAT_ROUNDS; round++) {
+        for (uint32_t i = 0; i < BENCH_FORMAT_COUNT; i++) {
+            pcf8563_raw_to_tm(raw + i * PCF8563_TIME_SIZE, &datetime);
+            strftime(buffer + i * PCF8563_ISO8601_SIZE, PCF8563_ISO8601_SIZE, "%Y-%m-%dT%H:%M:%S", &datetime);
+        }
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "pcf8563_raw_to_tm() + strftime()", elapsed * 1e9 / total);
+    printf("\n");
+}
+
+#define BENCH_TIMESTAMP_COUNT  (10000000)
+
+static uint64_t counter(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void bench_timestamp(void)
+{
+    pcf8563_timestamp_t timestamp;
+    struct timespec ts;
+    volatile int64_t sink;
+    double start, elapsed;
+
+    pcf8563_timestamp_init(&timestamp, NULL, &counter, 1000000000);
+    pcf8563_timestamp_edge(&timestamp, 1167002120, counter());
+
+    printf("Timestamps, %u calls\n", BENCH_TIMESTAMP_COUNT);
+
+    start = now();
+    for (uint32_t i = 0; i < BENCH_TIMESTAMP_COUNT; i++) {
+        sink = counter();
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "counter()", elapsed * 1e9 / BENCH_TIMESTAMP_COUNT);
+
+    start = now();
+    for (uint32_t i = 0; i < BENCH_TIMESTAMP_COUNT; i++) {
+        sink = pcf8563_timestamp_now(&timestamp);
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "pcf8563_timestamp_now()", elapsed * 1e9 / BENCH_TIMESTAMP_COUNT);
+
+    start = now();
+    for (uint32_t i = 0; i < BENCH_TIMESTAMP_COUNT; i++) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        sink = ts.tv_nsec;
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "clock_gettime(CLOCK_REALTIME)", elapsed * 1e9 / BENCH_TIMESTAMP_COUNT);
+    printf("\n");
+
+    (void)sink;
+}
+
+#define BENCH_REPLAY_PATH  "bench-replay.bin"
+#define BENCH_REPLAY_COUNT  (100000)
+#define BENCH_REPLAY_ROUNDS  (20)
+
+static uint64_t replay_clock;
+
+/* Each call moves the fake clock 50 ms forward. */
+static uint64_t replay_now(void)
+{
+    replay_clock += 50000;
+    return replay_clock;
+}
+
+static void record_trace(const char *path)
+{
+    pcf8563_record_t record;
+    pcf8563_t hal;
+    pcf8563_t pcf;
+    struct tm datetime;
+    uint8_t reg;
+
+    hal.read = &mock_i2c_read;
+    hal.write = &mock_i2c_write;
+    hal.handle = NULL;
+
+    pcf.read = &pcf8563_record_i2c_read;
+    pcf.write = &pcf8563_record_i2c_write;
+    pcf.handle = &record;
+
+    pcf8563_record_open(&record, &hal, path, &replay_now);
+    pcf8563_init(&pcf);
+    for (uint32_t i = 0; i < BENCH_REPLAY_COUNT; i++) {
+        pcf8563_read(&pcf, &datetime);
+        if (0 == i % 10) {
+            pcf8563_ioctl(&pcf, PCF8563_CONTROL_STATUS2_READ, &reg);
+        }
+    }
+    pcf8563_record_close(&record);
+}
+
+/*
+ * Time reads go through the driver, everything else straight to the HAL
+ * so that any recording can be replayed regardless of what made it.
+ */
+static uint32_t replay_round(pcf8563_replay_t *replay, const pcf8563_t *pcf, uint8_t driver)
+{
+    static uint8_t buffer[UINT16_MAX + 1];
+    pcf8563_replay_record_t record;
+    struct tm datetime;
+    uint32_t count = 0;
+    uint32_t mismatches;
+
+    pcf8563_replay_rewind(replay);
+    while (PCF8563_OK == pcf8563_replay_peek(replay, &record)) {
+        mismatches = replay->mismatches;
+        if (record.flags & PCF8563_RECORD_WRITE) {
+            pcf->write(pcf->handle, record.address, record.reg, record.data, record.size);
+        } else if (driver && PCF8563_ADDRESS == record.address && PCF8563_SECONDS == record.reg && PCF8563_TIME_SIZE == record.size) {
+            pcf8563_read(pcf, &datetime);
+        } else {
+            pcf->read(pcf->handle, record.address, record.reg, buffer, record.size);
+        }
+
+        /* Mismatch is not consumed by the HAL, skip it to keep going. */
+        if (replay->mismatches != mismatches) {
+            pcf8563_replay_next(replay, &record);
+        }
+        count++;
+    }
+    return count;
+}
+
+static void bench_replay(const char *path)
+{
+    pcf8563_replay_t replay;
+    pcf8563_t pcf;
+    double start, elapsed;
+    uint32_t count = 0;
+
+    if (NULL == path) {
+        path = BENCH_REPLAY_PATH;
+        record_trace(path);
+    }
+    if (PCF8563_OK != pcf8563_replay_open(&replay, path)) {
+        perror(path);
+        return;
+    }
+
+    pcf.read = &pcf8563_replay_i2c_read;
+    pcf.write = &pcf8563_replay_i2c_write;
+    pcf.handle = &replay;
+
+    count = replay_round(&replay, &pcf, 1);
+    printf(
+        "Replay of %s, %u transactions, %.1f bytes each, %.1f s recorded\n",
+        path, count, (double)(replay.size - PCF8563_RECORD_HEADER_SIZE) / count, replay.now_us / 1e6
+    );
+
+    start = now();
+    for (uint32_t round = 0; round < BENCH_REPLAY_ROUNDS; round++) {
+        replay_round(&replay, &pcf, 0);
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "pcf8563_replay_i2c_read()", elapsed * 1e9 / (count * BENCH_REPLAY_ROUNDS));
+
+    start = now();
+    for (uint32_t round = 0; round < BENCH_REPLAY_ROUNDS; round++) {
+        replay_round(&replay, &pcf, 1);
+    }
+    elapsed = now() - start;
+    printf("%-40s %8.1f ns\n", "pcf8563_read() from replay", elapsed * 1e9 / (count * BENCH_REPLAY_ROUNDS));
+
+    if (replay.mismatches) {
+        printf("%u transactions did not match the recording\n", replay.mismatches);
+    }
+    printf("\n");
+
+    pcf8563_replay_close(&replay);
+    if (0 == strcmp(path, BENCH_REPLAY_PATH)) {
+        unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench_coalesce();
+    bench_format();
+    bench_timestamp();
+    bench_replay(argc > 1 ? argv[1] : NULL);
+    return 0;
+}
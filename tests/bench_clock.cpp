@@ -0,0 +1,80 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "pcf8563.h"
+#include "pcf8563_clock.hpp"
+#include "mock_i2c.h"
+
+#define BENCH_ITERATIONS  (10000000)
+
+template <typename Clock>
+static double bench(void)
+{
+    std::int64_t sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (std::uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += Clock::now().time_since_epoch().count();
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    /* Keep the loop from being optimised away. */
+    if (sink == 42) {
+        std::printf("\n");
+    }
+    return elapsed.count() / BENCH_ITERATIONS;
+}
+
+int main(int argc, char **argv)
+{
+    pcf8563_t pcf;
+    pcf.read = &mock_i2c_read;
+    pcf.write = &mock_i2c_write;
+    pcf.handle = NULL;
+
+    pcf8563_write_datetime(&pcf, PCF8563_DATETIME(2006, 12, 24, 23, 15, 20, 0));
+    pcf8563_clock::sync(&pcf);
+
+    std::printf("now(), %u iterations\n", BENCH_ITERATIONS);
+    std::printf("%-32s %10.1f ns\n", "pcf8563_clock", bench<pcf8563_clock>());
+    std::printf("%-32s %10.1f ns\n", "std::chrono::system_clock", bench<std::chrono::system_clock>());
+    std::printf("%-32s %10.1f ns\n", "std::chrono::steady_clock", bench<std::chrono::steady_clock>());
+    std::printf("\n");
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+/*
+ * Differential validation of the calendar fast paths against libc. Walks
+ * every day from 1900 to 2099 with boundary seconds, every hour rollover of
+ * the first and last day of each month and with --full every second.
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pcf8563.h"
+
+#define CALENDAR_THREADS_MAX  (64)
+
+/* 1900-01-01 and 2100-01-01 */
+static const int64_t first_day = -25567;
+static const int64_t last_day = 47482;
+
+static const int32_t boundaries[] = {0, 1, 59, 60, 3599, 3600, 43199, 43200, 86340, 86399};
+
+static int full = 0;
+
+typedef struct {
+    int64_t from;
+    int64_t to;
+    uint64_t checks;
+    uint64_t failures;
+} calendar_job_t;
+
+static void fail(calendar_job_t *job, int64_t epoch, const char *what)
+{
+    if (job->failures++ < 10) {
+        fprintf(stderr, "FAIL %lld: %s\n", (long long)epoch, what);
+    }
+}
+
+static int same_tm(const struct tm *a, const struct tm *b)
+{
+    return a->tm_sec == b->tm_sec && a->tm_min == b->tm_min &&
+        a->tm_hour == b->tm_hour && a->tm_mday == b->tm_mday &&
+        a->tm_mon == b->tm_mon && a->tm_year == b->tm_year &&
+        a->tm_wday == b->tm_wday && a->tm_yday == b->tm_yday;
+}
+
+static void check(calendar_job_t *job, int64_t epoch)
+{
+    time_t seconds = (time_t)epoch;
+    struct tm expected, decoded;
+    uint8_t raw[PCF8563_TIME_SIZE];
+    uint8_t reference[PCF8563_TIME_SIZE];
+    uint8_t parsed[PCF8563_TIME_SIZE];
+    char iso[PCF8563_ISO8601_SIZE];
+    char buffer[PCF8563_ISO8601_SIZE];
+    pcf8563_datetime_t datetime;
+
+    job->checks++;
+    gmtime_r(&seconds, &expected);
+
+    /* Encode: epoch to registers against gmtime() + pcf8563_tm_to_raw(). */
+    if (PCF8563_OK != pcf8563_epoch_to_raw(epoch, raw)) {
+        fail(job, epoch, "pcf8563_epoch_to_raw() failed");
+        return;
+    }
+    pcf8563_tm_to_raw(&expected, reference);
+    if (0 != memcmp(raw, reference, PCF8563_TIME_SIZE)) {
+        fail(job, epoch, "pcf8563_epoch_to_raw() != gmtime()");
+    }
+
+    /* Decode: registers to struct tm as pcf8563_read() does it. */
+    memset(&decoded, 0, sizeof(decoded));
+    if (PCF8563_OK != pcf8563_raw_to_tm(raw, &decoded)) {
+        fail(job, epoch, "pcf8563_raw_to_tm() failed");
+    } else if (!same_tm(&decoded, &expected)) {
+        fail(job, epoch, "pcf8563_raw_to_tm() != gmtime()");
+    }
+
+    /* Decode: registers to epoch. */
+    datetime = pcf8563_raw_to_datetime(raw);
+    if (pcf8563_datetime_to_epoch(datetime) != epoch) {
+        fail(job, epoch, "pcf8563_datetime_to_epoch() != epoch");
+    }
+    if (pcf8563_datetime_from_epoch(epoch) != datetime) {
+        fail(job, epoch, "pcf8563_datetime_from_epoch() != registers");
+    }
+
+    pcf8563_datetime_to_tm(datetime, &decoded);
+    if (!same_tm(&decoded, &expected)) {
+        fail(job, epoch, "pcf8563_datetime_to_tm() != gmtime()");
+    }
+
+    /* Format and parse round trip against strftime(). */
+    pcf8563_format_iso8601(raw, iso);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &expected);
+    if (0 != strcmp(iso, buffer)) {
+        fail(job, epoch, "pcf8563_format_iso8601() != strftime()");
+    }
+    if (PCF8563_OK != pcf8563_parse_iso8601(buffer, parsed) || 0 != memcmp(raw, parsed, PCF8563_TIME_SIZE)) {
+        fail(job, epoch, "pcf8563_parse_iso8601() != registers");
+    }
+}
+
+static void *walk(void *argument)
+{
+    calendar_job_t *job = argument;
+    struct tm day;
+    time_t seconds;
+
+    for (int64_t days = job->from; days < job->to; days++) {
+        int64_t midnight = days * 86400;
+
+        if (full) {
+            for (int32_t second = 0; second < 86400; second++) {
+                check(job, midnight + second);
+            }
+            continue;
+        }
+
+        for (uint8_t i = 0; i < sizeof(boundaries) / sizeof(boundaries[0]); i++) {
+            check(job, midnight + boundaries[i]);
+        }
+
+        /* Every hour rollover of the first and last day of each month. */
+        seconds = (time_t)(midnight + 86400);
+        gmtime_r(&seconds, &day);
+        if (1 == day.tm_mday || 2 == day.tm_mday) {
+            for (int32_t hour = 1; hour < 24; hour++) {
+                check(job, midnight + hour * 3600 - 1);
+                check(job, midnight + hour * 3600);
+            }
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    calendar_job_t jobs[CALENDAR_THREADS_MAX];
+    pthread_t threads[CALENDAR_THREADS_MAX];
+    struct timespec start, end;
+    uint64_t checks = 0;
+    uint64_t failures = 0;
+    long count;
+    int64_t span;
+
+    if (argc > 1 && 0 == strcmp("--full", argv[1])) {
+        full = 1;
+    }
+
+    /*
+     * pcf8563_raw_to_tm() normalises with mktime() which works in local
+     * time. The RTC is assumed to be in UTC.
+     */
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) {
+        count = 1;
+    }
+    if (count > CALENDAR_THREADS_MAX) {
+        count = CALENDAR_THREADS_MAX;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    span = (last_day - first_day + count - 1) / count;
+    for (long i = 0; i < count; i++) {
+        jobs[i].from = first_day + i * span;
+        jobs[i].to = jobs[i].from + span < last_day ? jobs[i].from + span : last_day;
+        jobs[i].checks = 0;
+        jobs[i].failures = 0;
+        pthread_create(&threads[i], NULL, walk, &jobs[i]);
+    }
+
+    for (long i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+        checks += jobs[i].checks;
+        failures += jobs[i].failures;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf(
+        "Calendar: %llu checks, %llu failures, %ld threads, %.1f sec\n",
+        (unsigned long long)checks, (unsigned long long)failures, count,
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9
+    );
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
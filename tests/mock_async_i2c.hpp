@@ -0,0 +1,83 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _MOCK_ASYNC_I2C_HPP
+#define _MOCK_ASYNC_I2C_HPP
+
+#include <cstdint>
+
+#include "pcf8563.h"
+#include "pcf8563_async.hpp"
+#include "mock_i2c.h"
+
+/*
+ * Async bus on top of the mock memory. Like a real I2C bus it does one
+ * transfer at a time. Each takes delay_us of virtual time on the given
+ * executor and waits for the ones queued before it.
+ */
+struct mock_async_i2c {
+    pcf8563_executor *executor;
+    uint64_t delay_us;
+    uint32_t transfers;
+    uint64_t busy_until;
+};
+
+/* Virtual time from now until a transfer queued now has completed. */
+static uint64_t mock_async_i2c_queue(mock_async_i2c *bus)
+{
+    uint64_t now = bus->executor->now();
+
+    bus->transfers++;
+    bus->busy_until = (bus->busy_until > now ? bus->busy_until : now) + bus->delay_us;
+    return bus->busy_until - now;
+}
+
+static void mock_async_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size, pcf8563_async_done_t done, void *context)
+{
+    mock_async_i2c *bus = static_cast<mock_async_i2c *>(handle);
+
+    bus->executor->call_later(mock_async_i2c_queue(bus), [=]() {
+        done(context, mock_i2c_read(NULL, address, reg, buffer, size));
+    });
+}
+
+static void mock_async_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size, pcf8563_async_done_t done, void *context)
+{
+    mock_async_i2c *bus = static_cast<mock_async_i2c *>(handle);
+
+    bus->executor->call_later(mock_async_i2c_queue(bus), [=]() {
+        done(context, mock_i2c_write(NULL, address, reg, buffer, size));
+    });
+}
+
+#endif
@@ -31,20 +31,41 @@ SPDX-License-Identifier: MIT
 
 */
 
+#include <errno.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
 #include <stdint.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "pcf8563.h"
 #include "mock_i2c.h"
 
 uint8_t memory[255] = {0};
+volatile uint32_t mock_i2c_delay_us = 200;
+uint32_t mock_i2c_reads = 0;
+uint32_t mock_i2c_writes = 0;
+uint8_t mock_i2c_last_reg = 0;
+uint16_t mock_i2c_last_size = 0;
+
+uint8_t mock_fault_rate = 0;
+int32_t mock_fault_status = MOCK_I2C_ERROR;
+uint32_t mock_fault_seed = 1;
+
+uint8_t mock_mux_control = 0;
+uint8_t mock_mux_memory[8][256] = {0};
+uint32_t mock_mux_selects = 0;
 
 int32_t mock_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size) {
+    mock_i2c_reads++;
     memcpy(buffer, memory + reg, size);
     return PCF8563_OK;
 }
 
 int32_t mock_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size) {
+    mock_i2c_writes++;
+    mock_i2c_last_reg = reg;
+    mock_i2c_last_size = size;
     memcpy(memory + reg, buffer, size);
     return PCF8563_OK;
 }
@@ -62,3 +83,98 @@ int32_t mock_failing_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_
 int32_t mock_failing_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size) {
     return MOCK_I2C_ERROR;
 }
+
+int32_t mock_slow_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size) {
+    usleep(mock_i2c_delay_us);
+    memcpy(buffer, memory + reg, size);
+    return PCF8563_OK;
+}
+
+static uint8_t mock_fault(void) {
+    mock_fault_seed = mock_fault_seed * 1103515245 + 12345;
+    return (mock_fault_seed >> 16) % 100 < mock_fault_rate;
+}
+
+int32_t mock_faulty_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size) {
+    if (mock_fault()) {
+        return mock_fault_status;
+    }
+    return mock_i2c_read(handle, address, reg, buffer, size);
+}
+
+int32_t mock_faulty_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size) {
+    if (mock_fault()) {
+        return mock_fault_status;
+    }
+    return mock_i2c_write(handle, address, reg, buffer, size);
+}
+
+/* Device behind the mux answers only when exactly one channel is enabled. */
+static uint8_t *mock_mux_device(uint8_t address) {
+    if (PCF8563_ADDRESS != address || 0 == mock_mux_control) {
+        return NULL;
+    }
+    if (mock_mux_control & (mock_mux_control - 1)) {
+        return NULL;
+    }
+    return mock_mux_memory[__builtin_ctz(mock_mux_control)];
+}
+
+int32_t mock_mux_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size) {
+    uint8_t *device = mock_mux_device(address);
+
+    if (0x70 == address) {
+        buffer[0] = mock_mux_control;
+        return PCF8563_OK;
+    }
+    if (NULL == device) {
+        return MOCK_I2C_ERROR;
+    }
+    memcpy(buffer, device + reg, size);
+    return PCF8563_OK;
+}
+
+int32_t mock_mux_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size) {
+    uint8_t *device = mock_mux_device(address);
+
+    if (0x70 == address) {
+        mock_mux_selects++;
+        mock_mux_control = reg;
+        return PCF8563_OK;
+    }
+    if (NULL == device) {
+        return MOCK_I2C_ERROR;
+    }
+    memcpy(device + reg, buffer, size);
+    return PCF8563_OK;
+}
+
+int mock_i2cdev_ioctl(int fd, unsigned long request, void *argument) {
+    struct i2c_rdwr_ioctl_data *data = argument;
+    uint8_t pointer = 0;
+
+    if (-1 == fd) {
+        errno = EIO;
+        return -1;
+    }
+    if (I2C_RDWR != request) {
+        errno = ENOTTY;
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < data->nmsgs; i++) {
+        struct i2c_msg *message = &data->msgs[i];
+
+        if (message->flags & I2C_M_RD) {
+            memcpy(message->buf, memory + pointer, message->len);
+            pointer += message->len;
+        } else {
+            /* First byte sets the register pointer, rest is data. */
+            pointer = message->buf[0];
+            memcpy(memory + pointer, message->buf + 1, message->len - 1);
+            pointer += message->len - 1;
+        }
+    }
+
+    return data->nmsgs;
+}
@@ -31,10 +31,22 @@ SPDX-License-Identifier: MIT
 
 */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #include <stdint.h>
 
 #define MOCK_I2C_ERROR  (3)
 
+extern volatile uint32_t mock_i2c_delay_us;
+
+/* Bookkeeping of mock_i2c_read() and mock_i2c_write() calls. */
+extern uint32_t mock_i2c_reads;
+extern uint32_t mock_i2c_writes;
+extern uint8_t mock_i2c_last_reg;
+extern uint16_t mock_i2c_last_size;
+
 int32_t mock_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
 int32_t mock_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
 
@@ -42,3 +54,32 @@ int32_t mock_i2c_low_voltage_read(void *handle, uint8_t address, uint8_t reg, ui
 
 int32_t mock_failing_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
 int32_t mock_failing_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+int32_t mock_slow_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+
+/*
+ * Wraps mock_i2c_read() and mock_i2c_write(), failing mock_fault_rate
+ * percent of transactions with mock_fault_status. Deterministic for a
+ * given mock_fault_seed.
+ */
+extern uint8_t mock_fault_rate;
+extern int32_t mock_fault_status;
+extern uint32_t mock_fault_seed;
+
+int32_t mock_faulty_i2c_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t mock_faulty_i2c_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+/* Fake TCA9548A at 0x70 with a PCF8563 behind each of its channels. */
+extern uint8_t mock_mux_control;
+extern uint8_t mock_mux_memory[8][256];
+extern uint32_t mock_mux_selects;
+
+int32_t mock_mux_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t mock_mux_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+/* Fake Linux I2C adapter for pcf8563_i2cdev_t, fails if fd is -1. */
+int mock_i2cdev_ioctl(int fd, unsigned long request, void *argument);
+
+#ifdef __cplusplus
+}
+#endif
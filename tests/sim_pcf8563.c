@@ -0,0 +1,316 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pcf8563.h"
+#include "sim_pcf8563.h"
+
+#define SIM_REGISTERS  (16)
+
+/* Decoded time registers. */
+typedef struct {
+    uint8_t second;
+    uint8_t minute;
+    uint8_t hour;
+    uint8_t day;
+    uint8_t weekday;
+    uint8_t month;
+    uint8_t year;
+    uint8_t century;
+} sim_time_t;
+
+static uint8_t decimal2bcd(uint8_t decimal)
+{
+    return (((decimal / 10) << 4) | (decimal % 10));
+}
+
+static void unpack(const sim_pcf8563_t *sim, sim_time_t *time)
+{
+    const uint8_t *raw = &sim->registers[PCF8563_SECONDS];
+
+    time->second = pcf8563_raw_seconds(raw);
+    time->minute = pcf8563_raw_minutes(raw);
+    time->hour = pcf8563_raw_hours(raw);
+    time->day = pcf8563_raw_day(raw);
+    time->weekday = pcf8563_raw_weekday(raw);
+    time->month = pcf8563_raw_month(raw);
+    time->year = pcf8563_bcd2decimal(raw[6]);
+    time->century = raw[5] & PCF8563_CENTURY_BIT;
+}
+
+static void pack(sim_pcf8563_t *sim, const sim_time_t *time)
+{
+    uint8_t *raw = &sim->registers[PCF8563_SECONDS];
+
+    /* VL bit is kept as is. */
+    raw[0] = (raw[0] & 0b10000000) | decimal2bcd(time->second);
+    raw[1] = decimal2bcd(time->minute);
+    raw[2] = decimal2bcd(time->hour);
+    raw[3] = decimal2bcd(time->day);
+    raw[4] = time->weekday;
+    raw[5] = decimal2bcd(time->month) | time->century;
+    raw[6] = decimal2bcd(time->year);
+}
+
+/* The device considers every year divisible by four a leap year, also 00. */
+static uint8_t days_in_month(const sim_time_t *time)
+{
+    static const uint8_t days[13] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    if (2 == time->month && 0 == time->year % 4) {
+        return 29;
+    }
+    return days[time->month];
+}
+
+static void next_day(sim_time_t *time)
+{
+    time->weekday = (time->weekday + 1) % 7;
+    if (++time->day <= days_in_month(time)) {
+        return;
+    }
+    time->day = 1;
+    if (++time->month <= 12) {
+        return;
+    }
+    time->month = 1;
+    if (++time->year <= 99) {
+        return;
+    }
+    /* Century bit toggles when years overflow from 99 to 00. */
+    time->year = 0;
+    time->century ^= PCF8563_CENTURY_BIT;
+}
+
+static void next_minute(sim_time_t *time)
+{
+    if (++time->minute < 60) {
+        return;
+    }
+    time->minute = 0;
+    if (++time->hour < 24) {
+        return;
+    }
+    time->hour = 0;
+    next_day(time);
+}
+
+static uint8_t alarm_enabled(const sim_pcf8563_t *sim)
+{
+    for (uint8_t i = 0; i < PCF8563_ALARM_SIZE; i++) {
+        if (!(sim->registers[PCF8563_MINUTE_ALARM + i] & PCF8563_ALARM_DISABLE)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint8_t alarm_matches(const sim_pcf8563_t *sim, const sim_time_t *time)
+{
+    const uint8_t *alarm = &sim->registers[PCF8563_MINUTE_ALARM];
+    uint8_t value[PCF8563_ALARM_SIZE];
+
+    value[0] = decimal2bcd(time->minute);
+    value[1] = decimal2bcd(time->hour);
+    value[2] = decimal2bcd(time->day);
+    value[3] = time->weekday;
+
+    for (uint8_t i = 0; i < PCF8563_ALARM_SIZE; i++) {
+        if (alarm[i] & PCF8563_ALARM_DISABLE) {
+            continue;
+        }
+        if (alarm[i] != value[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void advance_clock(sim_pcf8563_t *sim, uint64_t seconds)
+{
+    sim_time_t time;
+    uint64_t total;
+
+    unpack(sim, &time);
+
+    /*
+     * Alarm is compared whenever the minute changes. Step minute by minute
+     * only while the alarm could still set AF.
+     */
+    while (seconds && alarm_enabled(sim) && !(sim->registers[PCF8563_CONTROL_STATUS2] & PCF8563_AF)) {
+        if (time.second + seconds < 60) {
+            time.second += seconds;
+            seconds = 0;
+            break;
+        }
+        seconds -= 60 - time.second;
+        time.second = 0;
+        next_minute(&time);
+
+        if (alarm_matches(sim, &time)) {
+            sim->registers[PCF8563_CONTROL_STATUS2] |= PCF8563_AF;
+        }
+    }
+
+    /* Otherwise step whole days. */
+    total = time.hour * 3600 + time.minute * 60 + time.second + seconds;
+    for (uint64_t day = total / 86400; day > 0; day--) {
+        next_day(&time);
+    }
+    total %= 86400;
+    time.hour = total / 3600;
+    time.minute = total / 60 % 60;
+    time.second = total % 60;
+
+    pack(sim, &time);
+}
+
+static void advance_timer(sim_pcf8563_t *sim, uint64_t ticks)
+{
+    static const uint32_t period[4] = {
+        /* 4096 Hz, 64 Hz, 1 Hz, 1/60 Hz */
+        1, SIM_PCF8563_HZ / 64, SIM_PCF8563_HZ, SIM_PCF8563_HZ * 60
+    };
+    uint8_t control = sim->registers[PCF8563_TIMER_CONTROL];
+    uint8_t count = sim->registers[PCF8563_TIMER];
+    uint64_t total, periods;
+
+    if (!(control & PCF8563_TIMER_ENABLE) || 0 == sim->timer_reload) {
+        return;
+    }
+
+    total = sim->timer_phase + ticks;
+    periods = total / period[control & 0b00000011];
+    sim->timer_phase = total % period[control & 0b00000011];
+
+    if (periods < count) {
+        sim->registers[PCF8563_TIMER] = count - periods;
+        return;
+    }
+
+    /* Reached zero at least once, set TF and reload. */
+    sim->registers[PCF8563_CONTROL_STATUS2] |= PCF8563_TF;
+    periods -= count;
+    sim->registers[PCF8563_TIMER] = sim->timer_reload - periods % sim->timer_reload;
+}
+
+void sim_pcf8563_init(sim_pcf8563_t *sim)
+{
+    memset(sim, 0, sizeof(sim_pcf8563_t));
+
+    /* 2000-01-01 00:00:00 Saturday */
+    sim->registers[PCF8563_DAY] = 0x01;
+    sim->registers[PCF8563_WEEKDAY] = 6;
+    sim->registers[PCF8563_MONTH] = 0x01 | PCF8563_CENTURY_BIT;
+
+    /* Alarms disabled, timer at 1/60 Hz and disabled. */
+    for (uint8_t i = 0; i < PCF8563_ALARM_SIZE; i++) {
+        sim->registers[PCF8563_MINUTE_ALARM + i] = PCF8563_ALARM_DISABLE;
+    }
+    sim->registers[PCF8563_TIMER_CONTROL] = PCF8563_TIMER_1_60HZ;
+}
+
+void sim_pcf8563_advance(sim_pcf8563_t *sim, uint64_t ticks)
+{
+    uint64_t total;
+
+    sim->ticks += ticks;
+
+    /* Stopped divider chain stops both the clock and the timer. */
+    if (sim->registers[PCF8563_CONTROL_STATUS1] & PCF8563_STOP) {
+        return;
+    }
+
+    advance_timer(sim, ticks);
+
+    total = sim->prescaler + ticks;
+    sim->prescaler = total % SIM_PCF8563_HZ;
+    advance_clock(sim, total / SIM_PCF8563_HZ);
+}
+
+void sim_pcf8563_advance_seconds(sim_pcf8563_t *sim, uint64_t seconds)
+{
+    sim_pcf8563_advance(sim, seconds * SIM_PCF8563_HZ);
+}
+
+/* Supply dropped below the low voltage threshold. */
+void sim_pcf8563_brownout(sim_pcf8563_t *sim)
+{
+    sim->registers[PCF8563_SECONDS] |= 0b10000000;
+}
+
+int32_t sim_pcf8563_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size)
+{
+    sim_pcf8563_t *sim = handle;
+
+    /* Register address wraps around after 0x0f. */
+    for (uint16_t i = 0; i < size; i++) {
+        buffer[i] = sim->registers[(reg + i) % SIM_REGISTERS];
+    }
+    return PCF8563_OK;
+}
+
+int32_t sim_pcf8563_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size)
+{
+    sim_pcf8563_t *sim = handle;
+    uint8_t flags;
+
+    for (uint16_t i = 0; i < size; i++) {
+        uint8_t target = (reg + i) % SIM_REGISTERS;
+        uint8_t value = buffer[i];
+
+        switch (target) {
+        case PCF8563_CONTROL_STATUS1:
+            /* Setting STOP resets the prescaler. */
+            if (value & PCF8563_STOP) {
+                sim->prescaler = 0;
+                sim->timer_phase = 0;
+            }
+            break;
+        case PCF8563_CONTROL_STATUS2:
+            /* Flags can only be cleared, writing one leaves them as is. */
+            flags = sim->registers[target] & value & (PCF8563_AF | PCF8563_TF);
+            value = (value & ~(PCF8563_AF | PCF8563_TF)) | flags;
+            break;
+        case PCF8563_TIMER:
+            sim->timer_reload = value;
+            sim->timer_phase = 0;
+            break;
+        }
+
+        sim->registers[target] = value;
+    }
+    return PCF8563_OK;
+}
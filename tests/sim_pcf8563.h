@@ -0,0 +1,70 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#ifndef _SIM_PCF8563_H
+#define _SIM_PCF8563_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Virtual time advances in ticks of the 4096 Hz prescaler output. */
+#define SIM_PCF8563_HZ  (4096)
+
+/*
+ * Behavioural model of the PCF8563 running on a virtual clock. Use a
+ * pointer to it as the handle of pcf8563_t together with sim_pcf8563_read()
+ * and sim_pcf8563_write().
+ */
+typedef struct {
+    uint8_t registers[16];
+    uint8_t timer_reload;
+    uint32_t prescaler;
+    uint32_t timer_phase;
+    uint64_t ticks;
+} sim_pcf8563_t;
+
+void sim_pcf8563_init(sim_pcf8563_t *sim);
+void sim_pcf8563_advance(sim_pcf8563_t *sim, uint64_t ticks);
+void sim_pcf8563_advance_seconds(sim_pcf8563_t *sim, uint64_t seconds);
+void sim_pcf8563_brownout(sim_pcf8563_t *sim);
+
+int32_t sim_pcf8563_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size);
+int32_t sim_pcf8563_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
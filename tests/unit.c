@@ -31,9 +31,26 @@ SPDX-License-Identifier: MIT
 
 */
 
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
 #include "greatest.h"
 #include "pcf8563.h"
 #include "mock_i2c.h"
+#include "sim_pcf8563.h"
+#include "pcf8563_hires.h"
+#include "pcf8563_health.h"
+#include "pcf8563_mux.h"
+#include "pcf8563_retry.h"
+#include "pcf8563_shm.h"
+#include "pcf8563_bus.h"
+#include "pcf8563_coalesce.h"
+#include "pcf8563_i2cdev.h"
+#include "pcf8563_timestamp.h"
+#include "pcf8563_record.h"
 
 TEST should_pass(void) {
     PASS();
@@ -58,6 +75,68 @@ TEST should_init(void) {
     PASS();
 }
 
+TEST should_init_warm(void) {
+    uint8_t reg;
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+
+    /* Already configured, only one read. */
+    mock_i2c_reads = 0;
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_init_warm(&bm));
+    ASSERT_EQ(1, mock_i2c_reads);
+    ASSERT_EQ(0, mock_i2c_writes);
+
+    /* Armed interrupts survive, stopped clock is restarted. */
+    reg = PCF8563_STOP;
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS1_WRITE, &reg));
+    reg = PCF8563_AIE | PCF8563_TIE;
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_WRITE, &reg));
+
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_init_warm(&bm));
+    ASSERT_EQ(1, mock_i2c_writes);
+    ASSERT_EQ(PCF8563_CONTROL_STATUS1, mock_i2c_last_reg);
+    ASSERT_EQ(1, mock_i2c_last_size);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS1_READ, &reg));
+    ASSERT_EQ(0, reg);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_EQ(PCF8563_AIE | PCF8563_TIE, reg);
+
+    /* Both registers need fixing, one two byte burst. */
+    reg = PCF8563_STOP;
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS1_WRITE, &reg));
+    reg = 0b11100000 | PCF8563_AIE;
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_WRITE, &reg));
+
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_init_warm(&bm));
+    ASSERT_EQ(1, mock_i2c_writes);
+    ASSERT_EQ(2, mock_i2c_last_size);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_EQ(PCF8563_AIE, reg);
+
+    PASS();
+}
+
+TEST should_warn_low_voltage_on_init_warm(void) {
+    uint8_t reg = 0b10000000;
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == mock_i2c_write(NULL, PCF8563_ADDRESS, PCF8563_SECONDS, &reg, 1));
+    ASSERT(PCF8563_ERR_LOW_VOLTAGE == pcf8563_init_warm(&bm));
+
+    reg = 0;
+    ASSERT(PCF8563_OK == mock_i2c_write(NULL, PCF8563_ADDRESS, PCF8563_SECONDS, &reg, 1));
+    PASS();
+}
+
 TEST should_fail_read_time(void) {
     struct tm datetime = {0};
     pcf8563_t bm;
@@ -69,6 +148,23 @@ TEST should_fail_read_time(void) {
     PASS();
 }
 
+TEST should_return_hal_errors_from_ioctl(void) {
+    struct tm alarm = {0};
+    uint8_t reg = 0;
+    pcf8563_t bm;
+    bm.read = &mock_faulty_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    mock_fault_rate = 100;
+    mock_fault_status = -EIO;
+    ASSERT_EQ(-EIO, pcf8563_ioctl(&bm, PCF8563_ALARM_READ, &alarm));
+    ASSERT_EQ(-EIO, pcf8563_ioctl(&bm, PCF8563_TIMER_CONTROL_READ, &reg));
+
+    mock_fault_rate = 0;
+    mock_fault_status = MOCK_I2C_ERROR;
+    PASS();
+}
+
 TEST should_get_low_voltage_warning(void) {
     struct tm datetime = {0};
     pcf8563_t bm;
@@ -161,6 +257,26 @@ TEST should_read_and_write_alarm(void) {
     PASS();
 }
 
+TEST should_read_and_write_weekday_alarm(void) {
+    struct tm datetime = {0};
+    struct tm datetime2 = {0};
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    datetime.tm_min = 0;
+    datetime.tm_hour = 7;
+    datetime.tm_mday = PCF8563_ALARM_NONE;
+    datetime.tm_wday = 1;
+
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_ALARM_SET, &datetime));
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_ALARM_READ, &datetime2));
+    ASSERT_EQ(PCF8563_ALARM_NONE, datetime2.tm_mday);
+    ASSERT_EQ(1, datetime2.tm_wday);
+
+    PASS();
+}
+
 TEST should_read_and_write_timer(void) {
     uint8_t count = 10;
     uint8_t reg =  PCF8563_TIMER_ENABLE | PCF8563_TIMER_1HZ;
@@ -184,6 +300,1857 @@ TEST should_read_and_write_timer(void) {
     PASS();
 }
 
+TEST should_configure_in_one_burst(void) {
+    pcf8563_config_t config = {0};
+    struct tm alarm = {0};
+    uint8_t reg;
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    config.alarm.tm_min = 30;
+    config.alarm.tm_hour = 21;
+    config.alarm.tm_mday = PCF8563_ALARM_NONE;
+    config.alarm.tm_wday = PCF8563_ALARM_NONE;
+    config.clkout = PCF8563_CLKOUT_ENABLE | PCF8563_CLKOUT_1HZ;
+    config.timer_control = PCF8563_TIMER_ENABLE | PCF8563_TIMER_1HZ;
+    config.timer = 10;
+    config.interrupts = PCF8563_INTERRUPTS_KEEP;
+
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_configure(&bm, &config));
+    ASSERT_EQ(1, mock_i2c_writes);
+    ASSERT_EQ(PCF8563_MINUTE_ALARM, mock_i2c_last_reg);
+    ASSERT_EQ(PCF8563_CONFIG_SIZE, mock_i2c_last_size);
+
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_ALARM_READ, &alarm));
+    ASSERT_EQ(30, alarm.tm_min);
+    ASSERT_EQ(21, alarm.tm_hour);
+    ASSERT_EQ(PCF8563_ALARM_NONE, alarm.tm_mday);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_READ, &reg));
+    ASSERT_EQ(10, reg);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_CONTROL_READ, &reg));
+    ASSERT_EQ(PCF8563_TIMER_ENABLE | PCF8563_TIMER_1HZ, reg);
+
+    /* Enabling interrupts costs one more write. */
+    config.interrupts = PCF8563_AIE | PCF8563_TIE;
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_configure(&bm, &config));
+    ASSERT_EQ(2, mock_i2c_writes);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_EQ(PCF8563_AIE | PCF8563_TIE, reg);
+
+    PASS();
+}
+
+TEST should_snapshot_and_restore(void) {
+    pcf8563_config_t config = {0};
+    pcf8563_snapshot_t snapshot;
+    pcf8563_snapshot_t snapshot2;
+    struct tm alarm = {0};
+    uint8_t reg;
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    config.alarm.tm_min = 30;
+    config.alarm.tm_hour = 21;
+    config.alarm.tm_mday = PCF8563_ALARM_NONE;
+    config.alarm.tm_wday = PCF8563_ALARM_NONE;
+    config.clkout = PCF8563_CLKOUT_ENABLE | PCF8563_CLKOUT_32HZ;
+    config.timer_control = PCF8563_TIMER_ENABLE | PCF8563_TIMER_64HZ;
+    config.timer = 100;
+    config.interrupts = PCF8563_AIE | PCF8563_TIE;
+
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_configure(&bm, &config));
+
+    mock_i2c_reads = 0;
+    ASSERT(PCF8563_OK == pcf8563_snapshot(&bm, &snapshot));
+    ASSERT_EQ(1, mock_i2c_reads);
+
+    /* Brown-out wiped everything. */
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    memset(&config, 0, sizeof(config));
+    ASSERT(PCF8563_OK == pcf8563_configure(&bm, &config));
+
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_restore(&bm, &snapshot));
+    ASSERT_EQ(2, mock_i2c_writes);
+
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_ALARM_READ, &alarm));
+    ASSERT_EQ(30, alarm.tm_min);
+    ASSERT_EQ(21, alarm.tm_hour);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_READ, &reg));
+    ASSERT_EQ(100, reg);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_EQ(PCF8563_AIE | PCF8563_TIE, reg);
+
+    ASSERT(PCF8563_OK == pcf8563_snapshot(&bm, &snapshot2));
+    ASSERT_MEM_EQ(&snapshot, &snapshot2, sizeof(snapshot));
+
+    /* Corrupted blob is not applied. */
+    snapshot.data[5] ^= 0x01;
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_ERR_CHECKSUM == pcf8563_restore(&bm, &snapshot));
+    ASSERT_EQ(0, mock_i2c_writes);
+
+    PASS();
+}
+
+TEST should_write_only_changed_registers(void) {
+    struct tm datetime = {0};
+    struct tm datetime2 = {0};
+    uint8_t image[PCF8563_TIME_SIZE];
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    datetime.tm_sec = 35;
+    datetime.tm_min = 15;
+    datetime.tm_hour = 23;
+    datetime.tm_mday = 27;
+    datetime.tm_mon = 11 - 1;
+    datetime.tm_year = 2002 - 1900;
+
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_write(&bm, &datetime));
+    ASSERT(PCF8563_OK == mock_i2c_read(NULL, PCF8563_ADDRESS, PCF8563_SECONDS, image, PCF8563_TIME_SIZE));
+
+    /* Pure seconds correction touches only the seconds register. */
+    datetime.tm_sec = 37;
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_write_diff(&bm, &datetime, image));
+    ASSERT_EQ(1, mock_i2c_writes);
+    ASSERT_EQ(PCF8563_SECONDS, mock_i2c_last_reg);
+    ASSERT_EQ(1, mock_i2c_last_size);
+
+    /* Unchanged time does not touch the bus at all. */
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_write_diff(&bm, &datetime, image));
+    ASSERT_EQ(0, mock_i2c_writes);
+
+    /* Minutes and hours are written as one span. */
+    datetime.tm_min = 16;
+    datetime.tm_hour = 22;
+    ASSERT(PCF8563_OK == pcf8563_write_diff(&bm, &datetime, image));
+    ASSERT_EQ(PCF8563_MINUTES, mock_i2c_last_reg);
+    ASSERT_EQ(2, mock_i2c_last_size);
+
+    /* Without an image the registers are burst read first. */
+    datetime.tm_year = 2003 - 1900;
+    mock_i2c_reads = 0;
+    ASSERT(PCF8563_OK == pcf8563_write_diff(&bm, &datetime, NULL));
+    ASSERT_EQ(1, mock_i2c_reads);
+    ASSERT_EQ(PCF8563_YEAR, mock_i2c_last_reg);
+    ASSERT_EQ(1, mock_i2c_last_size);
+
+    ASSERT(PCF8563_OK == pcf8563_read(&bm, &datetime2));
+    ASSERT_EQ(37, datetime2.tm_sec);
+    ASSERT_EQ(16, datetime2.tm_min);
+    ASSERT_EQ(22, datetime2.tm_hour);
+    ASSERT_EQ(27, datetime2.tm_mday);
+    ASSERT_EQ(2003 - 1900, datetime2.tm_year);
+
+    PASS();
+}
+
+TEST should_read_raw_and_decode_lazily(void) {
+    struct tm datetime = {0};
+    struct tm datetime2 = {0};
+    uint8_t raw[PCF8563_TIME_SIZE];
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    datetime.tm_sec = 20;
+    datetime.tm_min = 15;
+    datetime.tm_hour = 23;
+    datetime.tm_mday = 24;
+    datetime.tm_wday = 0;
+    datetime.tm_mon = 12 - 1;
+    datetime.tm_year = 2006 - 1900;
+
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_write(&bm, &datetime));
+    ASSERT(PCF8563_OK == pcf8563_read_raw(&bm, raw));
+
+    ASSERT_EQ(20, pcf8563_raw_seconds(raw));
+    ASSERT_EQ(15, pcf8563_raw_minutes(raw));
+    ASSERT_EQ(23, pcf8563_raw_hours(raw));
+    ASSERT_EQ(24, pcf8563_raw_day(raw));
+    ASSERT_EQ(0, pcf8563_raw_weekday(raw));
+    ASSERT_EQ(12, pcf8563_raw_month(raw));
+    ASSERT_EQ(2006, pcf8563_raw_year(raw));
+    ASSERT_EQ(0, pcf8563_raw_low_voltage(raw));
+
+    ASSERT(PCF8563_OK == pcf8563_raw_to_tm(raw, &datetime2));
+    ASSERT_EQ(357, datetime2.tm_yday);
+
+    raw[0] |= 0b10000000;
+    ASSERT_EQ(1, pcf8563_raw_low_voltage(raw));
+    ASSERT_EQ(20, pcf8563_raw_seconds(raw));
+    ASSERT(PCF8563_ERR_LOW_VOLTAGE == pcf8563_raw_to_tm(raw, &datetime2));
+
+    /* Century bit clear means 1900s. */
+    raw[5] &= ~PCF8563_CENTURY_BIT;
+    ASSERT_EQ(1906, pcf8563_raw_year(raw));
+
+    PASS();
+}
+
+TEST should_read_and_write_datetime(void) {
+    pcf8563_datetime_t datetime, datetime2;
+    struct tm tm = {0};
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    /* Sunday 2006-12-24 23:15:20 */
+    datetime = PCF8563_DATETIME(2006, 12, 24, 23, 15, 20, 0);
+
+    ASSERT_EQ(8, sizeof(pcf8563_datetime_t));
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, datetime));
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime2));
+    ASSERT_EQ(datetime, datetime2);
+
+    /* Interoperates with the struct tm API. */
+    ASSERT(PCF8563_OK == pcf8563_read(&bm, &tm));
+    ASSERT_EQ(datetime, pcf8563_datetime_from_tm(&tm));
+
+    PASS();
+}
+
+TEST should_convert_datetime(void) {
+    pcf8563_datetime_t a, b;
+    struct tm tm = {0};
+
+    a = PCF8563_DATETIME(2006, 12, 24, 23, 15, 20, 0);
+    ASSERT_EQ(1167002120, pcf8563_datetime_to_epoch(a));
+    ASSERT_EQ(a, pcf8563_datetime_from_epoch(1167002120));
+
+    pcf8563_datetime_to_tm(a, &tm);
+    ASSERT_EQ(2006 - 1900, tm.tm_year);
+    ASSERT_EQ(12 - 1, tm.tm_mon);
+    ASSERT_EQ(357, tm.tm_yday);
+    ASSERT_EQ(a, pcf8563_datetime_from_tm(&tm));
+
+    /* Thursday 1970-01-01 and Wednesday 1969-12-31 23:59:59 */
+    ASSERT_EQ(PCF8563_DATETIME(1970, 1, 1, 0, 0, 0, 4), pcf8563_datetime_from_epoch(0));
+    ASSERT_EQ(PCF8563_DATETIME(1969, 12, 31, 23, 59, 59, 3), pcf8563_datetime_from_epoch(-1));
+    ASSERT_EQ(-1, pcf8563_datetime_to_epoch(PCF8563_DATETIME(1969, 12, 31, 23, 59, 59, 3)));
+
+    /* Monday 1900-01-01 and leap day 2000-02-29 */
+    ASSERT_EQ(PCF8563_DATETIME(1900, 1, 1, 0, 0, 0, 1), pcf8563_datetime_from_epoch(-2208988800));
+    ASSERT_EQ(PCF8563_DATETIME(2000, 2, 29, 12, 0, 0, 2), pcf8563_datetime_from_epoch(951825600));
+
+    /* Out of range epochs are clamped instead of wrapping around. */
+    ASSERT_EQ(PCF8563_DATETIME(0, 1, 1, 0, 0, 0, 6), pcf8563_datetime_from_epoch(PCF8563_DATETIME_EPOCH_MIN));
+    ASSERT_EQ(PCF8563_DATETIME(9999, 12, 31, 23, 59, 59, 5), pcf8563_datetime_from_epoch(PCF8563_DATETIME_EPOCH_MAX));
+    ASSERT_EQ(PCF8563_DATETIME(0, 1, 1, 0, 0, 0, 6), pcf8563_datetime_from_epoch(-(1LL << 40)));
+    ASSERT_EQ(PCF8563_DATETIME(9999, 12, 31, 23, 59, 59, 5), pcf8563_datetime_from_epoch(1167002120 + 86400 * (1LL << 32)));
+
+    b = PCF8563_DATETIME(2006, 12, 25, 0, 0, 0, 1);
+    ASSERT_EQ(-1, pcf8563_datetime_compare(a, b));
+    ASSERT_EQ(1, pcf8563_datetime_compare(b, a));
+    ASSERT_EQ(0, pcf8563_datetime_compare(a, a + 1));
+    ASSERT_EQ(44 * 60 + 40, pcf8563_datetime_diff(b, a));
+    ASSERT_EQ(-(44 * 60 + 40), pcf8563_datetime_diff(a, b));
+
+    PASS();
+}
+
+TEST should_read_and_write_time_with_i2cdev(void) {
+    struct tm datetime = {0};
+    struct tm datetime2 = {0};
+    pcf8563_i2cdev_t dev = {0};
+    pcf8563_t bm;
+
+    dev.fd = 3;
+    dev.ioctl = &mock_i2cdev_ioctl;
+    bm.read = &pcf8563_i2cdev_read;
+    bm.write = &pcf8563_i2cdev_write;
+    bm.handle = &dev;
+
+    datetime.tm_sec = 20;
+    datetime.tm_min = 15;
+    datetime.tm_hour = 23;
+    datetime.tm_mday = 24;
+    datetime.tm_mon = 12 - 1;
+    datetime.tm_year = 2006 - 1900;
+
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_write(&bm, &datetime));
+    dev.transactions = 0;
+    ASSERT(PCF8563_OK == pcf8563_read(&bm, &datetime2));
+
+    /* Register write and data read happen in one ioctl. */
+    ASSERT_EQ(1, dev.transactions);
+    ASSERT_EQ(datetime.tm_sec, datetime2.tm_sec);
+    ASSERT_EQ(datetime.tm_mday, datetime2.tm_mday);
+    ASSERT_EQ(datetime.tm_year, datetime2.tm_year);
+
+    dev.fd = -1;
+    ASSERT_FALSE(PCF8563_OK == pcf8563_read(&bm, &datetime2));
+
+    PASS();
+}
+
+TEST should_batch_i2cdev_operations(void) {
+    uint8_t count = 10;
+    uint8_t control = PCF8563_TIMER_ENABLE | PCF8563_TIMER_1HZ;
+    uint8_t timer[2] = {0};
+    uint8_t raw[PCF8563_TIME_SIZE] = {0};
+    pcf8563_i2cdev_t dev = {0};
+    pcf8563_i2cdev_op_t ops[3] = {
+        {PCF8563_I2CDEV_WRITE, PCF8563_ADDRESS, PCF8563_TIMER, &count, 1},
+        {PCF8563_I2CDEV_WRITE, PCF8563_ADDRESS, PCF8563_TIMER_CONTROL, &control, 1},
+        {PCF8563_I2CDEV_READ, PCF8563_ADDRESS, PCF8563_TIMER_CONTROL, timer, 2},
+    };
+
+    dev.fd = 3;
+    dev.ioctl = &mock_i2cdev_ioctl;
+
+    ASSERT(PCF8563_OK == pcf8563_i2cdev_batch(&dev, ops, 3));
+    ASSERT_EQ(1, dev.transactions);
+    ASSERT_EQ(control, timer[0]);
+    ASSERT_EQ(count, timer[1]);
+
+    /* Too many messages for a single I2C_RDWR call. */
+    pcf8563_i2cdev_op_t many[PCF8563_I2CDEV_MAX_MESSAGES];
+    for (uint8_t i = 0; i < PCF8563_I2CDEV_MAX_MESSAGES; i++) {
+        many[i].direction = PCF8563_I2CDEV_READ;
+        many[i].address = PCF8563_ADDRESS;
+        many[i].reg = PCF8563_SECONDS;
+        many[i].buffer = raw;
+        many[i].size = PCF8563_TIME_SIZE;
+    }
+    ASSERT_EQ(-EINVAL, pcf8563_i2cdev_batch(&dev, many, PCF8563_I2CDEV_MAX_MESSAGES));
+    ASSERT_EQ(1, dev.transactions);
+
+    /* Bus errors are negative errno values. */
+    dev.fd = -1;
+    ASSERT_EQ(-EIO, pcf8563_i2cdev_read(&dev, PCF8563_ADDRESS, PCF8563_SECONDS, raw, PCF8563_TIME_SIZE));
+    ASSERT_EQ(-EIO, pcf8563_i2cdev_write(&dev, PCF8563_ADDRESS, PCF8563_TIMER, &count, 1));
+
+    PASS();
+}
+
+TEST should_format_iso8601(void) {
+    struct tm datetime = {0};
+    uint8_t raw[2 * PCF8563_TIME_SIZE];
+    char buffer[2 * PCF8563_ISO8601_SIZE];
+    char expected[PCF8563_ISO8601_SIZE];
+
+    datetime.tm_sec = 20;
+    datetime.tm_min = 15;
+    datetime.tm_hour = 23;
+    datetime.tm_mday = 24;
+    datetime.tm_mon = 12 - 1;
+    datetime.tm_year = 2006 - 1900;
+    pcf8563_tm_to_raw(&datetime, raw);
+
+    /* Low voltage bit is not part of the seconds. */
+    raw[0] |= 0b10000000;
+    pcf8563_format_iso8601(raw, buffer);
+    ASSERT_STR_EQ("2006-12-24T23:15:20", buffer);
+
+    datetime.tm_sec = 59;
+    datetime.tm_min = 59;
+    datetime.tm_hour = 9;
+    datetime.tm_mday = 1;
+    datetime.tm_mon = 1 - 1;
+    datetime.tm_year = 1999 - 1900;
+    pcf8563_tm_to_raw(&datetime, raw + PCF8563_TIME_SIZE);
+
+    pcf8563_format_iso8601_batch(raw, buffer, 2);
+    ASSERT_STR_EQ("2006-12-24T23:15:20", buffer);
+    ASSERT_STR_EQ("1999-01-01T09:59:59", buffer + PCF8563_ISO8601_SIZE);
+
+    strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%S", &datetime);
+    ASSERT_STR_EQ(expected, buffer + PCF8563_ISO8601_SIZE);
+
+    PASS();
+}
+
+TEST should_parse_iso8601(void) {
+    uint8_t raw[PCF8563_TIME_SIZE];
+    uint8_t raw2[PCF8563_TIME_SIZE];
+    char buffer[PCF8563_ISO8601_SIZE];
+    struct tm datetime = {0};
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    ASSERT(PCF8563_OK == pcf8563_parse_iso8601("2006-12-24T23:15:20", raw));
+    pcf8563_format_iso8601(raw, buffer);
+    ASSERT_STR_EQ("2006-12-24T23:15:20", buffer);
+    ASSERT_EQ(0, pcf8563_raw_weekday(raw));
+
+    ASSERT(PCF8563_OK == pcf8563_epoch_to_raw(1167002120, raw2));
+    ASSERT_MEM_EQ(raw, raw2, PCF8563_TIME_SIZE);
+
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_write_raw(&bm, raw));
+    ASSERT_EQ(1, mock_i2c_writes);
+    ASSERT(PCF8563_OK == pcf8563_read(&bm, &datetime));
+    ASSERT_EQ(2006 - 1900, datetime.tm_year);
+    ASSERT_EQ(24, datetime.tm_mday);
+
+    ASSERT(PCF8563_OK == pcf8563_parse_iso8601("1999-01-01 09:59:59Z", raw));
+    ASSERT_EQ(1999, pcf8563_raw_year(raw));
+    ASSERT_EQ(5, pcf8563_raw_weekday(raw));
+    ASSERT(PCF8563_OK == pcf8563_parse_iso8601("2000-02-29T00:00:00", raw));
+    ASSERT(PCF8563_OK == pcf8563_parse_iso8601("2096-02-29T00:00:00", raw));
+
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("1900-02-29T00:00:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2001-02-29T00:00:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-04-31T00:00:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-13-01T00:00:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-12-00T00:00:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-12-24T24:00:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-12-24T23:60:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-12-24T23:15:2x", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2100-01-01T00:00:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-12-24T23:15:20+02:00", raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_parse_iso8601("2006-12-24", raw));
+
+    ASSERT(PCF8563_OK == pcf8563_epoch_to_raw(4102444799, raw));
+    ASSERT_EQ(2099, pcf8563_raw_year(raw));
+    ASSERT(PCF8563_OK == pcf8563_epoch_to_raw(-2208988800, raw));
+    ASSERT_EQ(1900, pcf8563_raw_year(raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_epoch_to_raw(4102444800, raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_epoch_to_raw(-2208988801, raw));
+
+    /* Would wrap into 2006 if converted before the range check. */
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_epoch_to_raw(1167002120 + 86400 * (1LL << 32), raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_epoch_to_raw(1LL << 40, raw));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_epoch_to_raw(-(1LL << 40), raw));
+
+    PASS();
+}
+
+TEST should_simulate_calendar_rollover(void) {
+    pcf8563_datetime_t datetime;
+    sim_pcf8563_t sim;
+    pcf8563_t bm;
+    bm.read = &sim_pcf8563_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &sim;
+
+    sim_pcf8563_init(&sim);
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, PCF8563_DATETIME(1999, 12, 31, 23, 59, 59, 5)));
+    sim_pcf8563_advance_seconds(&sim, 1);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(PCF8563_DATETIME(2000, 1, 1, 0, 0, 0, 6), datetime);
+
+    /* Century bit toggles back, driver then assumes 1900. */
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, PCF8563_DATETIME(2099, 12, 31, 23, 59, 59, 4)));
+    sim_pcf8563_advance_seconds(&sim, 1);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(PCF8563_DATETIME(1900, 1, 1, 0, 0, 0, 5), datetime);
+
+    /* Sub second ticks accumulate in the prescaler. */
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, PCF8563_DATETIME(2000, 2, 28, 23, 59, 59, 1)));
+    sim_pcf8563_advance(&sim, SIM_PCF8563_HZ / 2);
+    sim_pcf8563_advance(&sim, SIM_PCF8563_HZ / 2);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(PCF8563_DATETIME(2000, 2, 29, 0, 0, 0, 2), datetime);
+
+    PASS();
+}
+
+TEST should_simulate_decades_quickly(void) {
+    pcf8563_datetime_t datetime;
+    int64_t epoch = 946684800;
+    uint64_t step = 86400 * 97 + 3599;
+    sim_pcf8563_t sim;
+    pcf8563_t bm;
+    bm.read = &sim_pcf8563_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &sim;
+
+    sim_pcf8563_init(&sim);
+
+    /* Walk 2000..2099 in irregular steps and compare with epoch math. */
+    while (epoch + step < 4102444800) {
+        sim_pcf8563_advance_seconds(&sim, step);
+        epoch += step;
+        ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+        ASSERT_EQ(pcf8563_datetime_from_epoch(epoch), datetime);
+    }
+
+    PASS();
+}
+
+TEST should_simulate_alarm(void) {
+    struct tm alarm = {0};
+    uint8_t reg;
+    sim_pcf8563_t sim;
+    pcf8563_t bm;
+    bm.read = &sim_pcf8563_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &sim;
+
+    sim_pcf8563_init(&sim);
+
+    /* Every Monday at 21:30, 2000-01-01 is a Saturday. */
+    alarm.tm_min = 30;
+    alarm.tm_hour = 21;
+    alarm.tm_mday = PCF8563_ALARM_NONE;
+    alarm.tm_wday = 1;
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_ALARM_SET, &alarm));
+
+    sim_pcf8563_advance_seconds(&sim, 2 * 86400 + 21 * 3600 + 29 * 60 + 59);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_FALSE(reg & PCF8563_AF);
+
+    sim_pcf8563_advance_seconds(&sim, 1);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT(reg & PCF8563_AF);
+
+    /* Clear the flag, next one is a week later. */
+    reg &= ~PCF8563_AF;
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_WRITE, &reg));
+    sim_pcf8563_advance_seconds(&sim, 7 * 86400 - 1);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_FALSE(reg & PCF8563_AF);
+    sim_pcf8563_advance_seconds(&sim, 1);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT(reg & PCF8563_AF);
+
+    PASS();
+}
+
+TEST should_compute_next_alarm(void) {
+    struct tm now = {0};
+    struct tm alarm = {0};
+    struct tm next = {0};
+
+    /* Sunday 2006-12-24 23:15:20 */
+    now.tm_sec = 20;
+    now.tm_min = 15;
+    now.tm_hour = 23;
+    now.tm_mday = 24;
+    now.tm_mon = 12 - 1;
+    now.tm_year = 2006 - 1900;
+    now.tm_wday = 0;
+
+    /* Minute only, fires every hour. */
+    alarm.tm_min = 30;
+    alarm.tm_hour = PCF8563_ALARM_NONE;
+    alarm.tm_mday = PCF8563_ALARM_NONE;
+    alarm.tm_wday = PCF8563_ALARM_NONE;
+    ASSERT(PCF8563_OK == pcf8563_alarm_next(&now, &alarm, &next));
+    ASSERT_EQ(23, next.tm_hour);
+    ASSERT_EQ(30, next.tm_min);
+    ASSERT_EQ(0, next.tm_sec);
+    ASSERT_EQ(24, next.tm_mday);
+
+    alarm.tm_min = 10;
+    ASSERT(PCF8563_OK == pcf8563_alarm_next(&now, &alarm, &next));
+    ASSERT_EQ(0, next.tm_hour);
+    ASSERT_EQ(10, next.tm_min);
+    ASSERT_EQ(25, next.tm_mday);
+    ASSERT_EQ(1, next.tm_wday);
+
+    /* Hour only, every minute of that hour. */
+    alarm.tm_min = PCF8563_ALARM_NONE;
+    alarm.tm_hour = 23;
+    ASSERT(PCF8563_OK == pcf8563_alarm_next(&now, &alarm, &next));
+    ASSERT_EQ(23, next.tm_hour);
+    ASSERT_EQ(16, next.tm_min);
+    ASSERT_EQ(24, next.tm_mday);
+
+    /* Weekday rolls over the year. */
+    alarm.tm_min = 0;
+    alarm.tm_hour = 7;
+    alarm.tm_wday = 3;
+    ASSERT(PCF8563_OK == pcf8563_alarm_next(&now, &alarm, &next));
+    ASSERT_EQ(27, next.tm_mday);
+    ASSERT_EQ(12 - 1, next.tm_mon);
+    ASSERT_EQ(3, next.tm_wday);
+
+    /* Day of month skips months which are too short. */
+    alarm.tm_wday = PCF8563_ALARM_NONE;
+    alarm.tm_mday = 31;
+    now.tm_mon = 1 - 1;
+    now.tm_mday = 31;
+    now.tm_wday = 3;
+    ASSERT(PCF8563_OK == pcf8563_alarm_next(&now, &alarm, &next));
+    ASSERT_EQ(31, next.tm_mday);
+    ASSERT_EQ(3 - 1, next.tm_mon);
+    ASSERT_EQ(2006 - 1900, next.tm_year);
+    ASSERT_EQ(31 + 28 + 30, next.tm_yday);
+
+    /* Day of month and weekday together, February 2006 has no 29th. */
+    alarm.tm_mday = 29;
+    alarm.tm_wday = 5;
+    now.tm_mon = 2 - 1;
+    now.tm_mday = 1;
+    ASSERT(PCF8563_OK == pcf8563_alarm_next(&now, &alarm, &next));
+    ASSERT_EQ(2006 - 1900, next.tm_year);
+    ASSERT_EQ(9 - 1, next.tm_mon);
+    ASSERT_EQ(29, next.tm_mday);
+
+    alarm.tm_min = PCF8563_ALARM_NONE;
+    alarm.tm_hour = PCF8563_ALARM_NONE;
+    alarm.tm_mday = PCF8563_ALARM_NONE;
+    alarm.tm_wday = PCF8563_ALARM_NONE;
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_alarm_next(&now, &alarm, &next));
+    alarm.tm_hour = 24;
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_alarm_next(&now, &alarm, &next));
+    PASS();
+}
+
+TEST should_predict_simulated_alarm(void) {
+    uint32_t seed = 1;
+    pcf8563_datetime_t datetime;
+    struct tm now, alarm, next;
+    int64_t wait;
+    uint8_t reg;
+    sim_pcf8563_t sim;
+    pcf8563_t bm;
+    bm.read = &sim_pcf8563_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &sim;
+
+    for (uint8_t i = 0; i < 100; i++) {
+        seed = seed * 1103515245 + 12345;
+        alarm.tm_min = seed & 0x010000 ? (seed >> 8) % 60 : PCF8563_ALARM_NONE;
+        alarm.tm_hour = seed & 0x020000 ? (seed >> 4) % 24 : PCF8563_ALARM_NONE;
+        alarm.tm_mday = seed & 0x040000 ? (seed >> 20) % 31 + 1 : PCF8563_ALARM_NONE;
+        alarm.tm_wday = seed & 0x080000 ? (seed >> 24) % 7 : PCF8563_ALARM_NONE;
+
+        sim_pcf8563_init(&sim);
+        sim_pcf8563_advance_seconds(&sim, (seed >> 1) % (400 * 86400));
+        ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+        pcf8563_datetime_to_tm(datetime, &now);
+
+        if (PCF8563_OK != pcf8563_alarm_next(&now, &alarm, &next)) {
+            continue;
+        }
+        ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_ALARM_SET, &alarm));
+
+        wait = pcf8563_datetime_to_epoch(pcf8563_datetime_from_tm(&next)) - pcf8563_datetime_to_epoch(datetime);
+        ASSERT(wait > 0);
+
+        sim_pcf8563_advance_seconds(&sim, wait - 1);
+        ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+        ASSERT_FALSE(reg & PCF8563_AF);
+
+        sim_pcf8563_advance_seconds(&sim, 1);
+        ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+        ASSERT(reg & PCF8563_AF);
+
+        ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+        ASSERT_EQ(next.tm_wday, pcf8563_datetime_weekday(datetime));
+    }
+    PASS();
+}
+
+static uint8_t cron_matches(const pcf8563_cron_t *cron, const struct tm *time) {
+    uint8_t day = cron->days >> time->tm_mday & 1;
+    uint8_t weekday = cron->weekdays >> time->tm_wday & 1;
+
+    if (!(cron->minutes >> time->tm_min & 1) || !(cron->hours >> time->tm_hour & 1)) {
+        return 0;
+    }
+    if (!(cron->months >> (time->tm_mon + 1) & 1)) {
+        return 0;
+    }
+    if (cron->flags) {
+        return day && weekday;
+    }
+    return day || weekday;
+}
+
+TEST should_plan_flag_polling(void) {
+    uint8_t raw[PCF8563_POLL_SIZE] = {0};
+    pcf8563_poll_t plan;
+
+    /* Sunday 2006-12-24 23:15:20, alarm and timer disabled. */
+    raw[PCF8563_SECONDS] = 0x20;
+    raw[PCF8563_MINUTES] = 0x15;
+    raw[PCF8563_HOURS] = 0x23;
+    raw[PCF8563_DAY] = 0x24;
+    raw[PCF8563_WEEKDAY] = 0x00;
+    raw[PCF8563_MONTH] = 0x12 | PCF8563_CENTURY_BIT;
+    raw[PCF8563_YEAR] = 0x06;
+    memset(&raw[PCF8563_MINUTE_ALARM], PCF8563_ALARM_DISABLE, PCF8563_ALARM_SIZE);
+
+    pcf8563_poll_plan_raw(raw, &plan);
+    ASSERT_EQ(0, plan.flags);
+    ASSERT_EQ(PCF8563_POLL_NEVER, plan.earliest_us);
+    ASSERT_EQ(PCF8563_POLL_NEVER, plan.latest_us);
+
+    /* Ten periods of 4096 Hz. */
+    raw[PCF8563_TIMER_CONTROL] = PCF8563_TIMER_ENABLE | PCF8563_TIMER_4_096KHZ;
+    raw[PCF8563_TIMER] = 10;
+    pcf8563_poll_plan_raw(raw, &plan);
+    ASSERT_EQ(2197, plan.earliest_us);
+    ASSERT_EQ(2442, plan.latest_us);
+
+    /* Alarm at 23:30 comes before 200 minutes of timer. */
+    raw[PCF8563_TIMER_CONTROL] = PCF8563_TIMER_ENABLE | PCF8563_TIMER_1_60HZ;
+    raw[PCF8563_TIMER] = 200;
+    raw[PCF8563_MINUTE_ALARM] = 0x30;
+    pcf8563_poll_plan_raw(raw, &plan);
+    ASSERT_EQ(879000000, plan.earliest_us);
+    ASSERT_EQ(880000000, plan.latest_us);
+
+    /* Nothing advances while stopped. */
+    raw[PCF8563_CONTROL_STATUS1] = PCF8563_STOP;
+    pcf8563_poll_plan_raw(raw, &plan);
+    ASSERT_EQ(PCF8563_POLL_NEVER, plan.earliest_us);
+
+    /* Flag already up, poll now. */
+    raw[PCF8563_CONTROL_STATUS2] = PCF8563_TF;
+    pcf8563_poll_plan_raw(raw, &plan);
+    ASSERT_EQ(PCF8563_TF, plan.flags);
+    ASSERT_EQ(0, plan.earliest_us);
+    PASS();
+}
+
+TEST should_poll_less_with_planner(void) {
+    const uint64_t interval = SIM_PCF8563_HZ / 100;
+    uint8_t count = 100;
+    uint8_t control = PCF8563_TIMER_ENABLE | PCF8563_TIMER_1HZ;
+    uint32_t fixed = 0, planned = 0;
+    uint64_t start, ticks;
+    uint8_t reg;
+    pcf8563_poll_t plan;
+    sim_pcf8563_t sim;
+    pcf8563_t bm;
+    bm.read = &sim_pcf8563_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &sim;
+
+    /* Poll CONTROL_STATUS2 every 10 ms. */
+    sim_pcf8563_init(&sim);
+    sim_pcf8563_advance(&sim, 1234);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_WRITE, &count));
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_CONTROL_WRITE, &control));
+    do {
+        sim_pcf8563_advance(&sim, interval);
+        ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+        fixed++;
+    } while (!(reg & PCF8563_TF));
+
+    /* Sleep until the earliest moment, then poll every 10 ms. */
+    sim_pcf8563_init(&sim);
+    sim_pcf8563_advance(&sim, 1234);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_WRITE, &count));
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_CONTROL_WRITE, &control));
+    start = sim.ticks;
+    for (;;) {
+        ASSERT(PCF8563_OK == pcf8563_poll_plan(&bm, &plan));
+        planned++;
+        if (plan.flags) {
+            break;
+        }
+        ASSERT(plan.latest_us <= 100000000);
+        ticks = plan.earliest_us * SIM_PCF8563_HZ / 1000000;
+        sim_pcf8563_advance(&sim, ticks > interval ? ticks : interval);
+    }
+
+    ASSERT_EQ(PCF8563_TF, plan.flags);
+    ASSERT(sim.ticks - start <= 100 * SIM_PCF8563_HZ + interval);
+    ASSERT(planned * 50 < fixed);
+    PASS();
+}
+
+static sim_pcf8563_t hires_sim;
+static uint32_t hires_latency = 3;
+
+/* Virtual time passes while the bus transaction is in progress. */
+static int32_t hires_sim_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size) {
+    sim_pcf8563_advance(handle, hires_latency);
+    return sim_pcf8563_read(handle, address, reg, buffer, size);
+}
+
+/* Coarse clock running 0.1% fast with an arbitrary offset. */
+static uint64_t hires_millis(void) {
+    return hires_sim.ticks * 1001 / SIM_PCF8563_HZ + 123456;
+}
+
+TEST should_timestamp_with_hires_timer(void) {
+    /* 2000-01-01 00:00:00 in Q52.12 */
+    const int64_t base = (int64_t)946684800 << PCF8563_HIRES_FRACTION;
+    uint32_t seed = 1;
+    pcf8563_hires_time_t timestamp, previous = 0;
+    int64_t truth;
+    pcf8563_hires_t hires = {0};
+    pcf8563_t bm;
+    bm.read = &hires_sim_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &hires_sim;
+
+    sim_pcf8563_init(&hires_sim);
+    sim_pcf8563_advance(&hires_sim, 12345);
+
+    ASSERT_EQ(PCF8563_ERR_STALE, pcf8563_hires_read(&hires, &timestamp));
+    ASSERT(PCF8563_OK == pcf8563_hires_start(&hires, &bm, &hires_millis));
+
+    for (uint16_t i = 0; i < 2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        sim_pcf8563_advance(&hires_sim, (seed >> 8) % 20000);
+
+        ASSERT(PCF8563_OK == pcf8563_hires_read(&hires, &timestamp));
+        truth = base + hires_sim.ticks;
+
+        /* Within the uncertainty of the calibrated second boundary. */
+        ASSERT(timestamp <= truth + hires_latency && timestamp >= truth - 2 * hires_latency);
+        ASSERT(timestamp > previous);
+        previous = timestamp;
+    }
+
+    /* Reads landing on a second boundary are retried. */
+    ASSERT(hires.retries > 0);
+
+    /* Coarse clock has drifted too far, calibrate again. */
+    sim_pcf8563_advance(&hires_sim, 61 * SIM_PCF8563_HZ);
+    ASSERT_EQ(PCF8563_ERR_STALE, pcf8563_hires_read(&hires, &timestamp));
+    ASSERT_EQ(PCF8563_ERR_STALE, pcf8563_hires_read(&hires, &timestamp));
+    ASSERT(PCF8563_OK == pcf8563_hires_calibrate(&hires));
+    ASSERT(PCF8563_OK == pcf8563_hires_read(&hires, &timestamp));
+    truth = base + hires_sim.ticks;
+    ASSERT(timestamp <= truth + hires_latency && timestamp >= truth - 2 * hires_latency);
+    PASS();
+}
+
+TEST should_compile_cron_expression(void) {
+    pcf8563_cron_t cron;
+
+    ASSERT(PCF8563_OK == pcf8563_cron_compile("*/15 9-17 * * 1-5", &cron));
+    ASSERT_EQ(0x0000200040008001, cron.minutes);
+    ASSERT_EQ(0b111111111000000000, cron.hours);
+    ASSERT_EQ(0xfffffffe, cron.days);
+    ASSERT_EQ(0b1111111111110, cron.months);
+    ASSERT_EQ(0b0111110, cron.weekdays);
+    ASSERT_EQ(PCF8563_CRON_ANY_DAY, cron.flags);
+
+    ASSERT(PCF8563_OK == pcf8563_cron_compile("0,30 5/6  13 2-12/5 7", &cron));
+    ASSERT_EQ(0x0000000040000001, cron.minutes);
+    ASSERT_EQ((1 << 5) | (1 << 11) | (1 << 17) | (1 << 23), cron.hours);
+    ASSERT_EQ(1 << 13, cron.days);
+    ASSERT_EQ((1 << 2) | (1 << 7) | (1 << 12), cron.months);
+    ASSERT_EQ(0b0000001, cron.weekdays);
+    ASSERT_EQ(0, cron.flags);
+
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("60 * * * *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("* * 0 * *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("* * *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("* * * * * *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("*/0 * * * *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("5-1 * * * *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("1, * * * *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_compile("x * * * *", &cron));
+    PASS();
+}
+
+TEST should_find_next_cron_occurrence(void) {
+    const char *expressions[] = {
+        "*/15 9-17 * * 1-5", "0 0 1 * *", "30 */6 * 2 *", "0 12 13 * 5", "59 23 31 * *", "0 0 29 2 *",
+        "0 0 29 2 1", "15 3 * * 0", "0 8 1-7 * 1"
+    };
+    pcf8563_cron_t cron;
+    struct tm now, next, time;
+    time_t epoch, last;
+
+    /* Friday 2006-12-29 17:50:10 */
+    epoch = 1167414610;
+
+    for (uint8_t i = 0; i < sizeof(expressions) / sizeof(expressions[0]); i++) {
+        ASSERT(PCF8563_OK == pcf8563_cron_compile(expressions[i], &cron));
+        gmtime_r(&epoch, &now);
+
+        /* Compare against a brute force walk of the following occurrences. */
+        for (uint8_t j = 0; j < 6; j++) {
+            ASSERT(PCF8563_OK == pcf8563_cron_next(&cron, &now, &next));
+            last = timegm(&now);
+            for (time_t t = last - last % 60 + 60; ; t += 60) {
+                gmtime_r(&t, &time);
+                if (cron_matches(&cron, &time)) {
+                    ASSERT_EQ(t, timegm(&next));
+                    break;
+                }
+            }
+            ASSERT_EQ(time.tm_wday, next.tm_wday);
+            ASSERT_EQ(time.tm_yday, next.tm_yday);
+            now = next;
+        }
+    }
+
+    /* Weekend is skipped. */
+    ASSERT(PCF8563_OK == pcf8563_cron_compile("*/15 9-17 * * 1-5", &cron));
+    gmtime_r(&epoch, &now);
+    ASSERT(PCF8563_OK == pcf8563_cron_next(&cron, &now, &next));
+    ASSERT_EQ(1, next.tm_mday);
+    ASSERT_EQ(1 - 1, next.tm_mon);
+    ASSERT_EQ(9, next.tm_hour);
+    ASSERT_EQ(0, next.tm_min);
+
+    /* No leap day in 2100. */
+    ASSERT(PCF8563_OK == pcf8563_cron_compile("0 0 29 2 *", &cron));
+    now.tm_year = 2096 - 1900;
+    now.tm_mon = 3 - 1;
+    ASSERT(PCF8563_OK == pcf8563_cron_next(&cron, &now, &next));
+    ASSERT_EQ(2104 - 1900, next.tm_year);
+    ASSERT_EQ(2 - 1, next.tm_mon);
+    ASSERT_EQ(29, next.tm_mday);
+    ASSERT_EQ(5, next.tm_wday);
+
+    ASSERT(PCF8563_OK == pcf8563_cron_compile("0 0 30 2 *", &cron));
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_cron_next(&cron, &now, &next));
+    PASS();
+}
+
+TEST should_arm_alarm_from_cron(void) {
+    uint8_t image[PCF8563_ALARM_SIZE];
+    uint8_t current[PCF8563_ALARM_SIZE];
+    pcf8563_cron_t cron;
+    struct tm now = {0};
+    struct tm next, alarm;
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    /* Monday 2007-01-01 09:05:00 */
+    now.tm_min = 5;
+    now.tm_hour = 9;
+    now.tm_mday = 1;
+    now.tm_mon = 1 - 1;
+    now.tm_year = 2007 - 1900;
+    now.tm_wday = 1;
+
+    ASSERT(PCF8563_OK == pcf8563_cron_compile("*/15 9-17 * * 1-5", &cron));
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+
+    /* First arming reads the registers. */
+    mock_i2c_reads = 0;
+    mock_i2c_writes = 0;
+    ASSERT(PCF8563_OK == pcf8563_cron_arm(&bm, &cron, &now, &next, NULL));
+    ASSERT_EQ(1, mock_i2c_reads);
+    ASSERT_EQ(1, mock_i2c_writes);
+    ASSERT_EQ(15, next.tm_min);
+    ASSERT_EQ(9, next.tm_hour);
+
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_ALARM_READ, &alarm));
+    ASSERT_EQ(15, alarm.tm_min);
+    ASSERT_EQ(9, alarm.tm_hour);
+    ASSERT_EQ(1, alarm.tm_mday);
+    ASSERT_EQ(PCF8563_ALARM_NONE, alarm.tm_wday);
+
+    /* Following occurrences change only the minute. */
+    bm.read(NULL, PCF8563_ADDRESS, PCF8563_MINUTE_ALARM, image, PCF8563_ALARM_SIZE);
+    mock_i2c_reads = 0;
+    mock_i2c_writes = 0;
+    now = next;
+    ASSERT(PCF8563_OK == pcf8563_cron_arm(&bm, &cron, &now, &next, image));
+    ASSERT_EQ(0, mock_i2c_reads);
+    ASSERT_EQ(1, mock_i2c_writes);
+    ASSERT_EQ(PCF8563_MINUTE_ALARM, mock_i2c_last_reg);
+    ASSERT_EQ(1, mock_i2c_last_size);
+    ASSERT_EQ(30, next.tm_min);
+
+    /* Into the next hour, minute and hour change. */
+    now.tm_min = 50;
+    ASSERT(PCF8563_OK == pcf8563_cron_arm(&bm, &cron, &now, &next, image));
+    ASSERT_EQ(2, mock_i2c_writes);
+    ASSERT_EQ(2, mock_i2c_last_size);
+    ASSERT_EQ(0, next.tm_min);
+    ASSERT_EQ(10, next.tm_hour);
+
+    /* Same occurrence again, nothing to write. */
+    ASSERT(PCF8563_OK == pcf8563_cron_arm(&bm, &cron, &now, &next, image));
+    ASSERT_EQ(2, mock_i2c_writes);
+    bm.read(NULL, PCF8563_ADDRESS, PCF8563_MINUTE_ALARM, current, PCF8563_ALARM_SIZE);
+    ASSERT_EQ(0, memcmp(image, current, PCF8563_ALARM_SIZE));
+
+    /* Only in March, the alarm wakes up on the 1st of February first. */
+    ASSERT(PCF8563_OK == pcf8563_cron_compile("0 0 1 3 *", &cron));
+    ASSERT(PCF8563_OK == pcf8563_cron_arm(&bm, &cron, &now, &next, image));
+    ASSERT_EQ(2 - 1, next.tm_mon);
+    ASSERT_EQ(1, next.tm_mday);
+    PASS();
+}
+
+TEST should_simulate_timer(void) {
+    uint8_t count = 10;
+    uint8_t control = PCF8563_TIMER_ENABLE | PCF8563_TIMER_64HZ;
+    uint8_t reg;
+    sim_pcf8563_t sim;
+    pcf8563_t bm;
+    bm.read = &sim_pcf8563_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &sim;
+
+    sim_pcf8563_init(&sim);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_WRITE, &count));
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_CONTROL_WRITE, &control));
+
+    sim_pcf8563_advance(&sim, 9 * SIM_PCF8563_HZ / 64);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_READ, &reg));
+    ASSERT_EQ(1, reg);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_FALSE(reg & PCF8563_TF);
+
+    sim_pcf8563_advance(&sim, SIM_PCF8563_HZ / 64);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT(reg & PCF8563_TF);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_READ, &reg));
+    ASSERT_EQ(10, reg);
+
+    /* Two minutes at 1/60 Hz. */
+    count = 2;
+    control = PCF8563_TIMER_ENABLE | PCF8563_TIMER_1_60HZ;
+    reg = 0;
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_WRITE, &reg));
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_WRITE, &count));
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_TIMER_CONTROL_WRITE, &control));
+
+    sim_pcf8563_advance_seconds(&sim, 119);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT_FALSE(reg & PCF8563_TF);
+    sim_pcf8563_advance_seconds(&sim, 1);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS2_READ, &reg));
+    ASSERT(reg & PCF8563_TF);
+
+    PASS();
+}
+
+TEST should_simulate_stop_and_low_voltage(void) {
+    pcf8563_datetime_t datetime;
+    uint8_t reg = PCF8563_STOP;
+    sim_pcf8563_t sim;
+    pcf8563_t bm;
+    bm.read = &sim_pcf8563_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &sim;
+
+    sim_pcf8563_init(&sim);
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS1_WRITE, &reg));
+    sim_pcf8563_advance_seconds(&sim, 3600);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(PCF8563_DATETIME(2000, 1, 1, 0, 0, 0, 6), datetime);
+
+    ASSERT(PCF8563_OK == pcf8563_init_warm(&bm));
+    sim_pcf8563_advance_seconds(&sim, 3600);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(PCF8563_DATETIME(2000, 1, 1, 1, 0, 0, 6), datetime);
+
+    /* VL stays set until the time is written. */
+    sim_pcf8563_brownout(&sim);
+    sim_pcf8563_advance_seconds(&sim, 60);
+    ASSERT(PCF8563_ERR_LOW_VOLTAGE == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, datetime));
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+
+    PASS();
+}
+
+static sim_pcf8563_t health_sim;
+static uint32_t health_transactions;
+
+static int32_t health_sim_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size) {
+    health_transactions++;
+    return sim_pcf8563_read(handle, address, reg, buffer, size);
+}
+
+static int32_t health_sim_write(void *handle, uint8_t address, uint8_t reg, const uint8_t *buffer, uint16_t size) {
+    health_transactions++;
+    return sim_pcf8563_write(handle, address, reg, buffer, size);
+}
+
+static uint64_t health_millis(void) {
+    return health_sim.ticks * 1000 / SIM_PCF8563_HZ;
+}
+
+TEST should_monitor_clock_health(void) {
+    pcf8563_datetime_t datetime;
+    pcf8563_health_t health;
+    uint8_t reg = PCF8563_STOP;
+    pcf8563_t sim;
+    pcf8563_t bm;
+
+    sim.read = &health_sim_read;
+    sim.write = &health_sim_write;
+    sim.handle = &health_sim;
+    bm.read = &pcf8563_health_i2c_read;
+    bm.write = &pcf8563_health_i2c_write;
+    bm.handle = &health;
+
+    sim_pcf8563_init(&health_sim);
+    ASSERT(PCF8563_OK == pcf8563_health_init(&health, &sim, &health_millis));
+    health_transactions = 0;
+
+    /* Once a second for almost ten minutes, one transaction per read. */
+    for (uint16_t i = 0; i < 590; i++) {
+        ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+        sim_pcf8563_advance_seconds(&health_sim, 1);
+    }
+    ASSERT_EQ(590, health_transactions);
+    ASSERT_EQ(590, health.reads);
+    ASSERT_EQ(10, health.checks);
+    ASSERT_EQ(0, health.state);
+
+    /* Stopped by someone else, seen on the next widened read. */
+    health_sim.registers[PCF8563_CONTROL_STATUS1] = PCF8563_STOP;
+    for (uint16_t i = 0; i < 5; i++) {
+        ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+        sim_pcf8563_advance_seconds(&health_sim, 1);
+    }
+    ASSERT_EQ(PCF8563_HEALTH_STALLED, health.state);
+    ASSERT_EQ(1, health.stall_events);
+    sim_pcf8563_advance_seconds(&health_sim, 60);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(PCF8563_HEALTH_STALLED | PCF8563_HEALTH_STOPPED, health.state);
+    ASSERT_EQ(1, health.stop_events);
+
+    /* Restarting clears both, the stall only once seconds advance. */
+    ASSERT(PCF8563_OK == pcf8563_init_warm(&bm));
+    ASSERT_EQ(PCF8563_HEALTH_STALLED, health.state);
+    sim_pcf8563_advance_seconds(&health_sim, 1);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(0, health.state);
+
+    /* Stopping through the monitor is seen without reading. */
+    ASSERT(PCF8563_OK == pcf8563_ioctl(&bm, PCF8563_CONTROL_STATUS1_WRITE, &reg));
+    ASSERT_EQ(PCF8563_HEALTH_STOPPED, health.state);
+    ASSERT_EQ(2, health.stop_events);
+    ASSERT(PCF8563_OK == pcf8563_init_warm(&bm));
+
+    /* VL is latched until the time is written. */
+    sim_pcf8563_brownout(&health_sim);
+    sim_pcf8563_advance_seconds(&health_sim, 1);
+    ASSERT(PCF8563_ERR_LOW_VOLTAGE == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT(PCF8563_ERR_LOW_VOLTAGE == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(PCF8563_HEALTH_LOW_VOLTAGE, health.state);
+    ASSERT_EQ(1, health.low_voltage_events);
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, datetime));
+    ASSERT_EQ(0, health.state);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(0, health.state);
+
+    PASS();
+}
+
+TEST should_detect_stall_between_sparse_reads(void) {
+    pcf8563_datetime_t datetime;
+    pcf8563_health_t health;
+    uint8_t seconds;
+    pcf8563_t sim;
+    pcf8563_t bm;
+
+    sim.read = &health_sim_read;
+    sim.write = &health_sim_write;
+    sim.handle = &health_sim;
+    bm.read = &pcf8563_health_i2c_read;
+    bm.write = &pcf8563_health_i2c_write;
+    bm.handle = &health;
+
+    sim_pcf8563_init(&health_sim);
+    ASSERT(PCF8563_OK == pcf8563_health_init(&health, &sim, &health_millis));
+    health.interval_ms = UINT32_MAX;
+
+    /* Hours, minutes and seconds do not wrap between reads minutes apart. */
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    health_sim.registers[PCF8563_CONTROL_STATUS1] = PCF8563_STOP;
+    for (uint16_t i = 0; i < 3; i++) {
+        sim_pcf8563_advance_seconds(&health_sim, 120);
+        ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    }
+    ASSERT_EQ(PCF8563_HEALTH_STALLED, health.state);
+    ASSERT_EQ(1, health.stall_events);
+
+    /* Seconds alone could have wrapped, so those are not flagged. */
+    ASSERT(PCF8563_OK == pcf8563_health_init(&health, &sim, &health_millis));
+    health.interval_ms = UINT32_MAX;
+    for (uint16_t i = 0; i < 3; i++) {
+        ASSERT(PCF8563_OK == bm.read(bm.handle, PCF8563_ADDRESS, PCF8563_SECONDS, &seconds, 1));
+        sim_pcf8563_advance_seconds(&health_sim, 120);
+    }
+    ASSERT_EQ(PCF8563_HEALTH_STOPPED, health.state);
+
+    PASS();
+}
+
+static sim_pcf8563_t record_sim;
+static int32_t record_fault;
+
+static int32_t record_sim_read(void *handle, uint8_t address, uint8_t reg, uint8_t *buffer, uint16_t size) {
+    if (record_fault) {
+        return record_fault;
+    }
+    sim_pcf8563_advance(handle, 2);
+    return sim_pcf8563_read(handle, address, reg, buffer, size);
+}
+
+static uint64_t record_now(void) {
+    return record_sim.ticks * 1000000 / SIM_PCF8563_HZ;
+}
+
+/* Same calls while recording and replaying. */
+static void record_workload(pcf8563_t *pcf, pcf8563_datetime_t *datetimes) {
+    pcf8563_datetime_t datetime = PCF8563_DATETIME(2006, 12, 24, 23, 15, 20, 0);
+    uint8_t reg = 0;
+
+    pcf8563_init(pcf);
+    pcf8563_write_datetime(pcf, datetime);
+    for (uint16_t i = 0; i < 100; i++) {
+        pcf8563_read_datetime(pcf, &datetimes[i]);
+        sim_pcf8563_advance_seconds(&record_sim, 1);
+    }
+    record_fault = -EREMOTEIO;
+    pcf8563_ioctl(pcf, PCF8563_CONTROL_STATUS2_READ, &reg);
+    record_fault = 0;
+}
+
+TEST should_record_and_replay_transactions(void) {
+    const char *path = "unit-record.bin";
+    static pcf8563_datetime_t recorded[100];
+    static pcf8563_datetime_t replayed[100];
+    pcf8563_replay_record_t last;
+    pcf8563_record_t record;
+    pcf8563_replay_t replay;
+    pcf8563_datetime_t datetime;
+    uint64_t end;
+    pcf8563_t sim;
+    pcf8563_t bm;
+
+    sim.read = &record_sim_read;
+    sim.write = &sim_pcf8563_write;
+    sim.handle = &record_sim;
+    sim_pcf8563_init(&record_sim);
+
+    bm.read = &pcf8563_record_i2c_read;
+    bm.write = &pcf8563_record_i2c_write;
+    bm.handle = &record;
+    ASSERT(PCF8563_OK == pcf8563_record_open(&record, &sim, path, &record_now));
+    record_workload(&bm, recorded);
+    end = record_now();
+    ASSERT(PCF8563_OK == pcf8563_record_close(&record));
+    ASSERT(record.records > 100);
+    ASSERT(record.bytes < 16 * record.records + PCF8563_RECORD_HEADER_SIZE);
+
+    /* Replay needs no device and returns the same data. */
+    bm.read = &pcf8563_replay_i2c_read;
+    bm.write = &pcf8563_replay_i2c_write;
+    bm.handle = &replay;
+    ASSERT(PCF8563_OK == pcf8563_replay_open(&replay, path));
+    record_workload(&bm, replayed);
+    ASSERT_EQ(record.records, replay.records);
+    ASSERT_EQ(0, replay.mismatches);
+    ASSERT_MEM_EQ(recorded, replayed, sizeof(recorded));
+    ASSERT_EQ(end, replay.now_us);
+    ASSERT(PCF8563_ERR_REPLAY_END == pcf8563_replay_peek(&replay, &last));
+
+    /* Recorded error is replayed too. */
+    pcf8563_replay_rewind(&replay);
+    while (PCF8563_OK == pcf8563_replay_next(&replay, &last)) {
+    }
+    ASSERT_EQ(-EREMOTEIO, last.status);
+    ASSERT(NULL == last.data);
+
+    /* Diverging call is reported and not consumed. */
+    pcf8563_replay_rewind(&replay);
+    ASSERT(PCF8563_ERR_REPLAY_MISMATCH == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(1, replay.mismatches);
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_replay_close(&replay));
+    unlink(path);
+
+    /* Full disk is reported instead of leaving a truncated trace. */
+    bm.read = &pcf8563_record_i2c_read;
+    bm.write = &pcf8563_record_i2c_write;
+    bm.handle = &record;
+    ASSERT(PCF8563_OK == pcf8563_record_open(&record, &sim, "/dev/full", &record_now));
+    /* Recording fails once the buffer is flushed but the bus keeps working. */
+    for (uint16_t i = 0; i < 1000 && PCF8563_OK == record.error; i++) {
+        ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    }
+    ASSERT_EQ(-ENOSPC, record.error);
+    ASSERT(PCF8563_OK == pcf8563_read_datetime(&bm, &datetime));
+    ASSERT_EQ(-ENOSPC, pcf8563_record_close(&record));
+
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_replay_open(&replay, "Makefile"));
+    ASSERT(-ENOENT == pcf8563_replay_open(&replay, "missing.bin"));
+
+    PASS();
+}
+
+TEST should_publish_and_read_shm_page(void) {
+    pcf8563_shm_page_t page;
+    pcf8563_shm_sample_t sample;
+
+    pcf8563_shm_init(&page);
+    ASSERT(PCF8563_ERR_NO_DATA == pcf8563_shm_read(&page, &sample));
+
+    /* 2006-12-24 23:15:20 UTC */
+    pcf8563_shm_publish(&page, PCF8563_OK, 1167002120, 1000);
+    ASSERT(PCF8563_OK == pcf8563_shm_read(&page, &sample));
+    ASSERT_EQ(1167002120, sample.epoch);
+    ASSERT_EQ(1000, sample.updated);
+    ASSERT_EQ(0, sample.sequence & 1);
+    ASSERT_EQ(2006 - 1900, sample.time.tm_year);
+    ASSERT_EQ(24, sample.time.tm_mday);
+    ASSERT_EQ(20, sample.time.tm_sec);
+
+    pcf8563_shm_publish(&page, PCF8563_ERR_LOW_VOLTAGE, 1167002121, 2000);
+    ASSERT(PCF8563_ERR_LOW_VOLTAGE == pcf8563_shm_read(&page, &sample));
+    ASSERT_EQ(1167002121, sample.epoch);
+
+    PASS();
+}
+
+TEST should_share_shm_page_between_mappings(void) {
+    pcf8563_shm_page_t *page;
+    const pcf8563_shm_page_t *client;
+    pcf8563_shm_sample_t sample;
+
+    page = pcf8563_shm_create("/pcf8563-unit");
+    ASSERT(NULL != page);
+    client = pcf8563_shm_open("/pcf8563-unit");
+    ASSERT(NULL != client);
+
+    pcf8563_shm_publish(page, PCF8563_OK, 1167002120, 1000);
+    ASSERT(PCF8563_OK == pcf8563_shm_read(client, &sample));
+    ASSERT_EQ(1167002120, sample.epoch);
+
+    pcf8563_shm_close(client);
+    pcf8563_shm_close(page);
+    pcf8563_shm_unlink("/pcf8563-unit");
+
+    PASS();
+}
+
+static uint64_t fake_now_us = 0;
+
+static uint64_t fake_now(void) {
+    return fake_now_us;
+}
+
+static void fake_sleep(uint32_t us) {
+    fake_now_us += us;
+}
+
+TEST should_classify_bus_errors(void) {
+    ASSERT_EQ(PCF8563_RETRY_NACK, pcf8563_retry_classify_errno(-ENXIO));
+    ASSERT_EQ(PCF8563_RETRY_NACK, pcf8563_retry_classify_errno(-EREMOTEIO));
+    ASSERT_EQ(PCF8563_RETRY_TIMEOUT, pcf8563_retry_classify_errno(-ETIMEDOUT));
+    ASSERT_EQ(PCF8563_RETRY_ARBITRATION, pcf8563_retry_classify_errno(-EAGAIN));
+    ASSERT_EQ(PCF8563_RETRY_OTHER, pcf8563_retry_classify_errno(-EINVAL));
+    PASS();
+}
+
+TEST should_retry_with_backoff(void) {
+    const uint8_t rates[] = {1, 5, 10, 25, 50};
+    pcf8563_retry_t retry;
+    pcf8563_t hal, pcf;
+    uint8_t data[PCF8563_TIME_SIZE];
+
+    hal.read = &mock_faulty_i2c_read;
+    hal.write = &mock_faulty_i2c_write;
+    pcf.read = &pcf8563_retry_i2c_read;
+    pcf.write = &pcf8563_retry_i2c_write;
+    pcf.handle = &retry;
+    mock_fault_status = -EAGAIN;
+
+    for (uint8_t i = 0; i < sizeof(rates); i++) {
+        ASSERT(PCF8563_OK == pcf8563_retry_init(&retry, &hal, &fake_now, &fake_sleep));
+        retry.policy.attempts = 8;
+        retry.policy.budget_us = 0;
+        mock_fault_rate = rates[i];
+        mock_fault_seed = 1;
+
+        for (uint16_t j = 0; j < 1000; j++) {
+            pcf8563_read_raw(&pcf, data);
+        }
+
+        ASSERT_EQ(1000, retry.stats.calls);
+        ASSERT_EQ(1000, retry.stats.successes + retry.stats.failures);
+        ASSERT_EQ(retry.stats.attempts - retry.stats.calls + retry.stats.failures, retry.stats.errors[PCF8563_RETRY_ARBITRATION]);
+        /* Chance of eight failures in a row is at most 1/256. */
+        ASSERT(retry.stats.failures <= 10);
+        ASSERT(retry.stats.attempts < 1000 * 100 / (100 - rates[i]) + 100);
+        /* Longest possible backoff is 1 + 2 + 4 + 5 * 8 milliseconds. */
+        ASSERT(retry.stats.backoff_us <= retry.stats.calls * 47000);
+    }
+
+    /* Errors which are not transient are returned immediately. */
+    ASSERT(PCF8563_OK == pcf8563_retry_init(&retry, &hal, &fake_now, &fake_sleep));
+    mock_fault_rate = 100;
+    mock_fault_status = -EINVAL;
+    ASSERT_EQ(-EINVAL, pcf8563_read_raw(&pcf, data));
+    ASSERT_EQ(1, retry.stats.attempts);
+    ASSERT_EQ(1, retry.stats.errors[PCF8563_RETRY_OTHER]);
+
+    mock_fault_rate = 0;
+    mock_fault_status = MOCK_I2C_ERROR;
+    PASS();
+}
+
+TEST should_respect_retry_budget(void) {
+    pcf8563_retry_t retry;
+    pcf8563_t hal, pcf;
+    uint8_t data[PCF8563_TIME_SIZE];
+
+    hal.read = &mock_faulty_i2c_read;
+    hal.write = &mock_faulty_i2c_write;
+    pcf.read = &pcf8563_retry_i2c_read;
+    pcf.write = &pcf8563_retry_i2c_write;
+    pcf.handle = &retry;
+    mock_fault_rate = 100;
+    mock_fault_status = -ETIMEDOUT;
+
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_retry_init(&retry, &hal, NULL, &fake_sleep));
+    ASSERT(PCF8563_ERR_INVALID == pcf8563_retry_init(&retry, &hal, &fake_now, NULL));
+    ASSERT(PCF8563_OK == pcf8563_retry_init(&retry, &hal, &fake_now, &fake_sleep));
+    retry.policy.attempts = 10;
+    retry.policy.budget_us = 5000;
+    fake_now_us = 0;
+
+    /* Sleeps 1 ms and 2 ms, another 4 ms would not fit. */
+    ASSERT_EQ(-ETIMEDOUT, pcf8563_read_raw(&pcf, data));
+    ASSERT_EQ(3, retry.stats.attempts);
+    ASSERT_EQ(1, retry.stats.exhausted);
+    ASSERT_EQ(3000, fake_now_us);
+    ASSERT_EQ(3, retry.stats.errors[PCF8563_RETRY_TIMEOUT]);
+
+    mock_fault_rate = 0;
+    mock_fault_status = MOCK_I2C_ERROR;
+    PASS();
+}
+
+TEST should_cache_mux_channel(void) {
+    pcf8563_mux_t mux;
+    pcf8563_mux_channel_t channels[2];
+    pcf8563_t hal, rtc[2];
+    struct tm datetime = {0};
+    struct tm datetime2 = {0};
+
+    hal.read = &mock_mux_read;
+    hal.write = &mock_mux_write;
+    mock_mux_control = 0;
+    mock_mux_selects = 0;
+
+    ASSERT(PCF8563_OK == pcf8563_mux_init(&mux, &hal, PCF8563_MUX_ADDRESS));
+
+    for (uint8_t i = 0; i < 2; i++) {
+        channels[i].mux = &mux;
+        channels[i].channel = i ? 5 : 1;
+        rtc[i].read = &pcf8563_mux_i2c_read;
+        rtc[i].write = &pcf8563_mux_i2c_write;
+        rtc[i].handle = &channels[i];
+    }
+
+    datetime.tm_sec = 20;
+    datetime.tm_min = 15;
+    datetime.tm_hour = 23;
+    datetime.tm_mday = 24;
+    datetime.tm_mon = 12 - 1;
+    datetime.tm_year = 2006 - 1900;
+
+    /* Consecutive accesses on one channel select only once. */
+    ASSERT(PCF8563_OK == pcf8563_init(&rtc[0]));
+    ASSERT(PCF8563_OK == pcf8563_write(&rtc[0], &datetime));
+    ASSERT_EQ(1, mock_mux_selects);
+    ASSERT_EQ(1 << 1, mock_mux_control);
+
+    datetime.tm_year = 2021 - 1900;
+    ASSERT(PCF8563_OK == pcf8563_init(&rtc[1]));
+    ASSERT(PCF8563_OK == pcf8563_write(&rtc[1], &datetime));
+    ASSERT_EQ(2, mock_mux_selects);
+
+    ASSERT(PCF8563_OK == pcf8563_read(&rtc[0], &datetime2));
+    ASSERT_EQ(2006 - 1900, datetime2.tm_year);
+    ASSERT(PCF8563_OK == pcf8563_read(&rtc[1], &datetime2));
+    ASSERT_EQ(2021 - 1900, datetime2.tm_year);
+    ASSERT_EQ(4, mock_mux_selects);
+
+    /* Select is repeated after the cache has been invalidated. */
+    pcf8563_mux_invalidate(&mux);
+    ASSERT(PCF8563_OK == pcf8563_read(&rtc[1], &datetime2));
+    ASSERT_EQ(5, mock_mux_selects);
+    ASSERT_EQ(PCF8563_ERR_INVALID, pcf8563_mux_select(&mux, PCF8563_MUX_CHANNELS));
+    PASS();
+}
+
+TEST should_group_mux_batch_by_channel(void) {
+    pcf8563_mux_t mux;
+    pcf8563_t hal;
+    uint8_t seconds[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+    uint8_t buffer[6] = {0};
+    pcf8563_mux_op_t ops[6];
+    const uint8_t channels[6] = {2, 0, 7, 0, 2, 7};
+
+    hal.read = &mock_mux_read;
+    hal.write = &mock_mux_write;
+    mock_mux_control = 0;
+    mock_mux_selects = 0;
+
+    ASSERT(PCF8563_OK == pcf8563_mux_init(&mux, &hal, PCF8563_MUX_ADDRESS));
+    ASSERT(PCF8563_OK == pcf8563_mux_select(&mux, 7));
+
+    /* Interleaved writes to three RTCs, channel 7 is already selected. */
+    for (uint8_t i = 0; i < 6; i++) {
+        ops[i].channel = channels[i];
+        ops[i].direction = PCF8563_MUX_WRITE;
+        ops[i].address = PCF8563_ADDRESS;
+        ops[i].reg = PCF8563_SECONDS + (i & 1);
+        ops[i].buffer = &seconds[i];
+        ops[i].size = 1;
+    }
+    ASSERT(PCF8563_OK == pcf8563_mux_batch(&mux, ops, 6));
+    ASSERT_EQ(3, mock_mux_selects);
+    ASSERT_EQ(0x33, mock_mux_memory[7][PCF8563_SECONDS]);
+    ASSERT_EQ(0x66, mock_mux_memory[7][PCF8563_MINUTES]);
+
+    /* Order within a channel is kept. */
+    ASSERT_EQ(0x55, mock_mux_memory[2][PCF8563_SECONDS]);
+    ASSERT_EQ(0x44, mock_mux_memory[0][PCF8563_MINUTES]);
+
+    for (uint8_t i = 0; i < 6; i++) {
+        ops[i].direction = PCF8563_MUX_READ;
+        ops[i].buffer = &buffer[i];
+    }
+    ASSERT(PCF8563_OK == pcf8563_mux_batch(&mux, ops, 6));
+    ASSERT_EQ(5, mock_mux_selects);
+    ASSERT_EQ(0x33, buffer[2]);
+    ASSERT_EQ(0x44, buffer[3]);
+
+    /* Failing operation is reported but the rest still run. */
+    ops[0].channel = PCF8563_MUX_CHANNELS;
+    ops[1].address = 0x52;
+    ASSERT_FALSE(PCF8563_OK == pcf8563_mux_batch(&mux, ops, 6));
+    ASSERT_EQ(PCF8563_ERR_INVALID, ops[0].status);
+    ASSERT_EQ(MOCK_I2C_ERROR, ops[1].status);
+    ASSERT_EQ(PCF8563_OK, ops[2].status);
+    PASS();
+}
+
+static pcf8563_coalesce_t coalesce;
+static pthread_barrier_t barrier;
+
+static void *coalesce_reader(void *arg) {
+    struct tm *datetime = arg;
+
+    pthread_barrier_wait(&barrier);
+    if (PCF8563_OK != pcf8563_coalesce_read(&coalesce, datetime)) {
+        datetime->tm_year = -1;
+    }
+    return NULL;
+}
+
+TEST should_coalesce_concurrent_reads(void) {
+    struct tm datetime = {0};
+    struct tm results[8] = {0};
+    pthread_t threads[8];
+    pcf8563_t bm;
+    bm.read = &mock_slow_i2c_read;
+    bm.write = &mock_i2c_write;
+
+    datetime.tm_sec = 20;
+    datetime.tm_min = 15;
+    datetime.tm_hour = 23;
+    datetime.tm_mday = 24;
+    datetime.tm_mon = 12 - 1;
+    datetime.tm_year = 2006 - 1900;
+
+    mock_i2c_delay_us = 5000;
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_write(&bm, &datetime));
+    ASSERT(PCF8563_OK == pcf8563_coalesce_init(&coalesce, &bm));
+    pthread_barrier_init(&barrier, NULL, 8);
+
+    for (uint8_t i = 0; i < 8; i++) {
+        pthread_create(&threads[i], NULL, coalesce_reader, &results[i]);
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        pthread_join(threads[i], NULL);
+        ASSERT_EQ(datetime.tm_year, results[i].tm_year);
+        ASSERT_EQ(datetime.tm_sec, results[i].tm_sec);
+    }
+
+    ASSERT_EQ(8, coalesce.requests);
+    ASSERT(coalesce.transactions < coalesce.requests);
+
+    pthread_barrier_destroy(&barrier);
+    pcf8563_coalesce_close(&coalesce);
+    mock_i2c_delay_us = 200;
+    PASS();
+}
+
+static pcf8563_bus_t bus;
+static atomic_uint bus_order;
+
+typedef struct {
+    pcf8563_bus_client_t client;
+    pcf8563_t pcf;
+    uint32_t order;
+    uint32_t reads;
+    int32_t status;
+} bus_producer_t;
+
+static void *bus_waiter(void *arg) {
+    bus_producer_t *producer = arg;
+
+    producer->status = pcf8563_bus_acquire(&bus, producer->client.priority, 0);
+    producer->order = atomic_fetch_add(&bus_order, 1);
+    pcf8563_bus_release(&bus);
+    return NULL;
+}
+
+static void *bus_producer(void *arg) {
+    bus_producer_t *producer = arg;
+    struct tm datetime;
+
+    pthread_barrier_wait(&barrier);
+    for (uint32_t i = 0; i < producer->reads; i++) {
+        if (PCF8563_OK != pcf8563_read(&producer->pcf, &datetime)) {
+            producer->status = -1;
+        }
+    }
+    return NULL;
+}
+
+static void bus_wait_for(uint32_t waiting) {
+    uint32_t current = 0;
+
+    while (current < waiting) {
+        usleep(100);
+        pthread_mutex_lock(&bus.mutex);
+        current = bus.waiting;
+        pthread_mutex_unlock(&bus.mutex);
+    }
+}
+
+TEST should_prioritise_shared_bus(void) {
+    bus_producer_t low = {0}, high = {0};
+    pthread_t threads[2];
+    pcf8563_bus_stats_t stats;
+    pcf8563_t hal, rtc;
+    struct tm datetime;
+
+    hal.read = &mock_i2c_read;
+    hal.write = &mock_i2c_write;
+    low.client.priority = PCF8563_BUS_PRIORITY_LOW;
+    high.client.priority = PCF8563_BUS_PRIORITY_HIGH;
+
+    ASSERT(PCF8563_OK == pcf8563_bus_init(&bus));
+
+    /* High priority overtakes a low priority request queued earlier. */
+    bus.aging = 1000000000;
+    atomic_store(&bus_order, 0);
+    ASSERT(PCF8563_OK == pcf8563_bus_acquire(&bus, PCF8563_BUS_PRIORITY_NORMAL, 0));
+    pthread_create(&threads[0], NULL, bus_waiter, &low);
+    bus_wait_for(1);
+    pthread_create(&threads[1], NULL, bus_waiter, &high);
+    bus_wait_for(2);
+    pcf8563_bus_release(&bus);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    ASSERT_EQ(0, high.order);
+    ASSERT_EQ(1, low.order);
+
+    /* Without aging headroom the older request wins. */
+    bus.aging = 0;
+    atomic_store(&bus_order, 0);
+    ASSERT(PCF8563_OK == pcf8563_bus_acquire(&bus, PCF8563_BUS_PRIORITY_NORMAL, 0));
+    pthread_create(&threads[0], NULL, bus_waiter, &low);
+    bus_wait_for(1);
+    pthread_create(&threads[1], NULL, bus_waiter, &high);
+    bus_wait_for(2);
+    pcf8563_bus_release(&bus);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    ASSERT_EQ(0, low.order);
+    ASSERT_EQ(1, high.order);
+    ASSERT(PCF8563_OK == low.status && PCF8563_OK == high.status);
+
+    /* Request gives up when the bus is not granted before deadline. */
+    high.client.bus = &bus;
+    high.client.hal = &hal;
+    high.client.timeout = 1000000;
+    rtc.read = &pcf8563_bus_i2c_read;
+    rtc.write = &pcf8563_bus_i2c_write;
+    rtc.handle = &high.client;
+
+    ASSERT(PCF8563_OK == pcf8563_bus_acquire(&bus, PCF8563_BUS_PRIORITY_LOW, 0));
+    ASSERT_EQ(PCF8563_ERR_DEADLINE, pcf8563_read(&rtc, &datetime));
+    pcf8563_bus_release(&bus);
+    ASSERT(PCF8563_OK == pcf8563_read(&rtc, &datetime));
+
+    pcf8563_bus_stats(&bus, PCF8563_BUS_PRIORITY_HIGH, &stats);
+    ASSERT_EQ(1, stats.missed);
+    ASSERT_EQ(0, bus.waiting);
+    ASSERT_EQ(0, bus.busy);
+
+    pcf8563_bus_close(&bus);
+    PASS();
+}
+
+TEST should_arbitrate_shared_bus_between_threads(void) {
+    bus_producer_t producers[5] = {0};
+    pthread_t threads[5];
+    pcf8563_bus_stats_t low, high;
+    pcf8563_t hal;
+
+    hal.read = &mock_slow_i2c_read;
+    hal.write = &mock_i2c_write;
+    mock_i2c_delay_us = 500;
+
+    ASSERT(PCF8563_OK == pcf8563_bus_init(&bus));
+    pthread_barrier_init(&barrier, NULL, 5);
+
+    /* Four streaming sensors and the RTC share the bus. */
+    for (uint8_t i = 0; i < 5; i++) {
+        producers[i].client.bus = &bus;
+        producers[i].client.hal = &hal;
+        producers[i].client.priority = i ? PCF8563_BUS_PRIORITY_LOW : PCF8563_BUS_PRIORITY_HIGH;
+        producers[i].pcf.read = &pcf8563_bus_i2c_read;
+        producers[i].pcf.write = &pcf8563_bus_i2c_write;
+        producers[i].pcf.handle = &producers[i].client;
+        producers[i].reads = 20;
+        pthread_create(&threads[i], NULL, bus_producer, &producers[i]);
+    }
+    for (uint8_t i = 0; i < 5; i++) {
+        pthread_join(threads[i], NULL);
+        ASSERT_EQ(PCF8563_OK, producers[i].status);
+    }
+
+    pcf8563_bus_stats(&bus, PCF8563_BUS_PRIORITY_LOW, &low);
+    pcf8563_bus_stats(&bus, PCF8563_BUS_PRIORITY_HIGH, &high);
+
+    /* Every request got through, the RTC never waited behind the queue. */
+    ASSERT_EQ(80, low.transactions);
+    ASSERT_EQ(20, high.transactions);
+    ASSERT_EQ(0, low.missed + high.missed);
+    ASSERT(high.total_ns / high.transactions < low.total_ns / low.transactions);
+
+    pthread_barrier_destroy(&barrier);
+    pcf8563_bus_close(&bus);
+    mock_i2c_delay_us = 200;
+    PASS();
+}
+
+static pcf8563_timestamp_t stamp;
+static atomic_ullong stamp_fake;
+static uint32_t stamp_drift_ppm = 0;
+
+/* Nominal 1 GHz counter driven by the simulator, optionally running fast. */
+static uint64_t stamp_sim_counter(void) {
+    uint64_t ns = hires_sim.ticks * 1000000000 / SIM_PCF8563_HZ;
+    return ns + ns / 1000000 * stamp_drift_ppm + 777;
+}
+
+static uint64_t stamp_fake_counter(void) {
+    return atomic_fetch_add(&stamp_fake, 13);
+}
+
+static void *stamp_reader(void *arg) {
+    int64_t previous = INT64_MIN;
+    int64_t now;
+    uint32_t *violations = arg;
+
+    pthread_barrier_wait(&barrier);
+    for (uint32_t i = 0; i < 200000; i++) {
+        now = pcf8563_timestamp_now(&stamp);
+        if (now <= previous) {
+            (*violations)++;
+        }
+        previous = now;
+    }
+    return NULL;
+}
+
+TEST should_anchor_timestamps_on_rtc_edges(void) {
+    /* 2000-01-01 00:00:00 in nanoseconds */
+    const int64_t base = (int64_t)946684800 * 1000000000;
+    int64_t now, previous, truth;
+    pcf8563_t bm;
+    bm.read = &hires_sim_read;
+    bm.write = &sim_pcf8563_write;
+    bm.handle = &hires_sim;
+
+    sim_pcf8563_init(&hires_sim);
+    sim_pcf8563_advance(&hires_sim, 1000);
+    stamp_drift_ppm = 200;
+
+    ASSERT(PCF8563_OK == pcf8563_timestamp_init(&stamp, &bm, &stamp_sim_counter, 1000000000));
+    ASSERT(PCF8563_OK == pcf8563_timestamp_sync(&stamp));
+    ASSERT_EQ(1, stamp.steps);
+
+    truth = base + hires_sim.ticks * 1000000000 / SIM_PCF8563_HZ;
+    now = pcf8563_timestamp_now(&stamp);
+    ASSERT(now - truth < 1000000 && truth - now < 1000000);
+
+    /* Counter runs 200 ppm fast, 2 ms off after ten seconds. */
+    sim_pcf8563_advance_seconds(&hires_sim, 10);
+    truth = base + hires_sim.ticks * 1000000000 / SIM_PCF8563_HZ;
+    now = pcf8563_timestamp_now(&stamp);
+    ASSERT(now - truth > 1500000);
+
+    /* Error is slewed away without going backwards. */
+    ASSERT(PCF8563_OK == pcf8563_timestamp_sync(&stamp));
+    ASSERT_EQ(1, stamp.steps);
+    ASSERT(stamp.offset_ns < -1500000);
+
+    previous = pcf8563_timestamp_now(&stamp);
+    for (uint16_t i = 0; i < 1000; i++) {
+        sim_pcf8563_advance(&hires_sim, SIM_PCF8563_HZ / 100);
+        now = pcf8563_timestamp_now(&stamp);
+        ASSERT(now > previous);
+        ASSERT(now - previous < 10000000 + 10000);
+        previous = now;
+    }
+    truth = base + hires_sim.ticks * 1000000000 / SIM_PCF8563_HZ;
+    ASSERT(now - truth < 1000000 && truth - now < 1000000);
+
+    /* Large forward error is stepped. */
+    sim_pcf8563_write(&hires_sim, PCF8563_ADDRESS, PCF8563_MINUTES, (const uint8_t []){0x30}, 1);
+    ASSERT(PCF8563_OK == pcf8563_timestamp_sync(&stamp));
+    ASSERT_EQ(2, stamp.steps);
+    ASSERT(pcf8563_timestamp_now(&stamp) > now + 60000000000);
+
+    stamp_drift_ppm = 0;
+    PASS();
+}
+
+TEST should_keep_timestamps_monotonic_across_threads(void) {
+    uint32_t violations[4] = {0};
+    pthread_t threads[4];
+    int64_t seconds;
+
+    atomic_store(&stamp_fake, 1000);
+    ASSERT(PCF8563_OK == pcf8563_timestamp_init(&stamp, NULL, &stamp_fake_counter, 1000000000));
+    pthread_barrier_init(&barrier, NULL, 5);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, stamp_reader, &violations[i]);
+    }
+
+    /* Resync with errors both ways while readers are running. */
+    pthread_barrier_wait(&barrier);
+    for (uint16_t i = 0; i < 2000; i++) {
+        seconds = pcf8563_timestamp_now(&stamp) / 1000000000 + (i & 1);
+        pcf8563_timestamp_edge(&stamp, seconds, stamp_fake_counter());
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        ASSERT_EQ(0, violations[i]);
+    }
+    ASSERT_EQ(2000, stamp.syncs);
+
+    pthread_barrier_destroy(&barrier);
+    PASS();
+}
+
 GREATEST_MAIN_DEFS();
 
 int main(int argc, char **argv) {
@@ -192,12 +2159,54 @@ int main(int argc, char **argv) {
     RUN_TEST(should_pass);
     RUN_TEST(should_fail_init);
     RUN_TEST(should_init);
+    RUN_TEST(should_init_warm);
+    RUN_TEST(should_warn_low_voltage_on_init_warm);
     RUN_TEST(should_fail_read_time);
+    RUN_TEST(should_return_hal_errors_from_ioctl);
     RUN_TEST(should_get_low_voltage_warning);
     RUN_TEST(should_read_and_write_time);
     RUN_TEST(should_handle_century);
     RUN_TEST(should_read_and_write_alarm);
+    RUN_TEST(should_read_and_write_weekday_alarm);
     RUN_TEST(should_read_and_write_timer);
+    RUN_TEST(should_configure_in_one_burst);
+    RUN_TEST(should_snapshot_and_restore);
+    RUN_TEST(should_write_only_changed_registers);
+    RUN_TEST(should_read_raw_and_decode_lazily);
+    RUN_TEST(should_read_and_write_datetime);
+    RUN_TEST(should_convert_datetime);
+    RUN_TEST(should_read_and_write_time_with_i2cdev);
+    RUN_TEST(should_batch_i2cdev_operations);
+    RUN_TEST(should_format_iso8601);
+    RUN_TEST(should_parse_iso8601);
+    RUN_TEST(should_simulate_calendar_rollover);
+    RUN_TEST(should_simulate_decades_quickly);
+    RUN_TEST(should_simulate_alarm);
+    RUN_TEST(should_compute_next_alarm);
+    RUN_TEST(should_predict_simulated_alarm);
+    RUN_TEST(should_plan_flag_polling);
+    RUN_TEST(should_poll_less_with_planner);
+    RUN_TEST(should_timestamp_with_hires_timer);
+    RUN_TEST(should_compile_cron_expression);
+    RUN_TEST(should_find_next_cron_occurrence);
+    RUN_TEST(should_arm_alarm_from_cron);
+    RUN_TEST(should_simulate_timer);
+    RUN_TEST(should_simulate_stop_and_low_voltage);
+    RUN_TEST(should_monitor_clock_health);
+    RUN_TEST(should_detect_stall_between_sparse_reads);
+    RUN_TEST(should_record_and_replay_transactions);
+    RUN_TEST(should_classify_bus_errors);
+    RUN_TEST(should_retry_with_backoff);
+    RUN_TEST(should_respect_retry_budget);
+    RUN_TEST(should_cache_mux_channel);
+    RUN_TEST(should_group_mux_batch_by_channel);
+    RUN_TEST(should_publish_and_read_shm_page);
+    RUN_TEST(should_share_shm_page_between_mappings);
+    RUN_TEST(should_coalesce_concurrent_reads);
+    RUN_TEST(should_prioritise_shared_bus);
+    RUN_TEST(should_arbitrate_shared_bus_between_threads);
+    RUN_TEST(should_anchor_timestamps_on_rtc_edges);
+    RUN_TEST(should_keep_timestamps_monotonic_across_threads);
 
     GREATEST_MAIN_END();
 }
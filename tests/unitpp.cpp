@@ -0,0 +1,215 @@
+/*
+
+MIT License
+
+Copyright (c) 2020-2021 Mika Tuupola
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+-cut-
+
+This file is part of hardware agnostic I2C driver for PCF8563 RTC:
+https://github.com/tuupola/pcf8563
+
+SPDX-License-Identifier: MIT
+
+*/
+
+#include <chrono>
+#include <ctime>
+
+#include "greatest.h"
+#include "pcf8563.h"
+#include "pcf8563_clock.hpp"
+#include "pcf8563_async.hpp"
+#include "mock_i2c.h"
+#include "mock_async_i2c.hpp"
+
+TEST should_sync_and_extrapolate_clock(void) {
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+    bm.handle = NULL;
+
+    /* 2006-12-24 23:15:20 */
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, PCF8563_DATETIME(2006, 12, 24, 23, 15, 20, 0)));
+    ASSERT(PCF8563_OK == pcf8563_clock::sync(&bm));
+
+    pcf8563_clock::time_point first = pcf8563_clock::now();
+    ASSERT_EQ(1167002120, pcf8563_clock::to_time_t(first));
+
+    /* No bus access after sync, time is extrapolated. */
+    mock_i2c_reads = 0;
+    pcf8563_clock::time_point second = pcf8563_clock::now();
+    ASSERT_EQ(0, mock_i2c_reads);
+    ASSERT(second >= first);
+
+    std::chrono::seconds elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+        pcf8563_clock::now() - pcf8563_clock::from_time_t(1167002120)
+    );
+    ASSERT(elapsed.count() < 1);
+
+    PASS();
+}
+
+TEST should_fail_clock_sync(void) {
+    pcf8563_t bm;
+    bm.read = &mock_failing_i2c_read;
+    bm.write = &mock_failing_i2c_write;
+    bm.handle = NULL;
+
+    ASSERT_FALSE(PCF8563_OK == pcf8563_clock::sync(&bm));
+    PASS();
+}
+
+TEST should_not_wait_for_frozen_clock_edge(void) {
+    pcf8563_t bm;
+    bm.read = &mock_i2c_read;
+    bm.write = &mock_i2c_write;
+    bm.handle = NULL;
+
+    /* Mock registers never change so the edge never comes. */
+    ASSERT(PCF8563_OK == pcf8563_init(&bm));
+    ASSERT(PCF8563_OK == pcf8563_write_datetime(&bm, PCF8563_DATETIME(2006, 12, 24, 23, 15, 20, 0)));
+    ASSERT_EQ(PCF8563_ERR_STALE, pcf8563_clock::sync(&bm, true));
+    PASS();
+}
+
+static pcf8563_task async_roundtrip(const pcf8563_async *rtc, int *result) {
+    struct tm datetime = {0};
+    struct tm datetime2 = {0};
+    struct tm alarm = {0};
+    struct tm alarm2 = {0};
+    uint8_t control = 0;
+    uint8_t count = 0;
+
+    datetime.tm_sec = 20;
+    datetime.tm_min = 15;
+    datetime.tm_hour = 23;
+    datetime.tm_mday = 24;
+    datetime.tm_mon = 12 - 1;
+    datetime.tm_year = 2006 - 1900;
+
+    alarm.tm_min = 30;
+    alarm.tm_hour = 21;
+    alarm.tm_mday = 24;
+    alarm.tm_wday = 3;
+
+    *result = 1;
+    if (PCF8563_OK != co_await rtc->write(&datetime)) co_return;
+    if (PCF8563_OK != co_await rtc->read(&datetime2)) co_return;
+    if (PCF8563_OK != co_await rtc->alarm_set(&alarm)) co_return;
+    if (PCF8563_OK != co_await rtc->alarm_read(&alarm2)) co_return;
+    if (PCF8563_OK != co_await rtc->timer_write(PCF8563_TIMER_ENABLE | PCF8563_TIMER_1HZ, 10)) co_return;
+    if (PCF8563_OK != co_await rtc->timer_read(&control, &count)) co_return;
+
+    if (datetime.tm_sec != datetime2.tm_sec) co_return;
+    if (datetime.tm_year != datetime2.tm_year) co_return;
+    if (alarm.tm_min != alarm2.tm_min) co_return;
+    if (alarm.tm_mday != alarm2.tm_mday) co_return;
+    if (alarm.tm_wday != alarm2.tm_wday) co_return;
+    if ((PCF8563_TIMER_ENABLE | PCF8563_TIMER_1HZ) != control) co_return;
+    if (10 != count) co_return;
+
+    *result = 0;
+}
+
+TEST should_await_rtc_operations(void) {
+    pcf8563_executor executor;
+    mock_async_i2c bus = {&executor, 100, 0};
+    pcf8563_async_t hal = {&mock_async_i2c_read, &mock_async_i2c_write, &bus};
+    pcf8563_async rtc(&hal);
+    int result = -1;
+
+    executor.spawn(async_roundtrip(&rtc, &result));
+    executor.run();
+
+    ASSERT_EQ(0, result);
+    ASSERT_EQ(6, bus.transfers);
+    ASSERT_EQ(600, executor.now());
+    PASS();
+}
+
+static pcf8563_task async_reader(pcf8563_executor *executor, const pcf8563_async *rtc, uint32_t *done) {
+    struct tm datetime = {0};
+
+    if (PCF8563_OK != co_await rtc->read(&datetime)) co_return;
+    /* Some other I/O between the reads. */
+    co_await executor->sleep(1000);
+    if (PCF8563_OK != co_await rtc->read(&datetime)) co_return;
+
+    (*done)++;
+}
+
+TEST should_overlap_async_operations(void) {
+    pcf8563_executor executor;
+    mock_async_i2c bus = {&executor, 250, 0};
+    pcf8563_async_t hal = {&mock_async_i2c_read, &mock_async_i2c_write, &bus};
+    pcf8563_async rtc(&hal);
+    uint32_t done = 0;
+
+    /*
+     * Serially two readers take 2 * 1500 us. The second one uses the bus
+     * while the first one sleeps.
+     */
+    for (uint16_t i = 0; i < 2; i++) {
+        executor.spawn(async_reader(&executor, &rtc, &done));
+    }
+    executor.run();
+
+    ASSERT_EQ(2, done);
+    ASSERT_EQ(4, bus.transfers);
+    ASSERT_EQ(250 + 250 + 750 + 250 + 250, executor.now());
+    PASS();
+}
+
+TEST should_hide_sleeps_behind_bus_time(void) {
+    pcf8563_executor executor;
+    mock_async_i2c bus = {&executor, 250, 0};
+    pcf8563_async_t hal = {&mock_async_i2c_read, &mock_async_i2c_write, &bus};
+    pcf8563_async rtc(&hal);
+    uint32_t done = 0;
+
+    for (uint16_t i = 0; i < 200; i++) {
+        executor.spawn(async_reader(&executor, &rtc, &done));
+    }
+    executor.run();
+
+    /* Bus is busy all the time and no reader ever waits for its sleep. */
+    ASSERT_EQ(200, done);
+    ASSERT_EQ(400, bus.transfers);
+    ASSERT_EQ(400 * 250, executor.now());
+    PASS();
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+
+    RUN_TEST(should_sync_and_extrapolate_clock);
+    RUN_TEST(should_fail_clock_sync);
+    RUN_TEST(should_not_wait_for_frozen_clock_edge);
+    RUN_TEST(should_await_rtc_operations);
+    RUN_TEST(should_overlap_async_operations);
+    RUN_TEST(should_hide_sleeps_behind_bus_time);
+
+    GREATEST_MAIN_END();
+}